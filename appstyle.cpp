@@ -0,0 +1,198 @@
+#include "appstyle.h"
+#include <QApplication>
+#include <QPainter>
+#include <QPixmap>
+#include <QStyle>
+#include <QVariant>
+#include <QWidget>
+
+void AppStyle::apply(QApplication *app)
+{
+    app->setStyleSheet(styleSheet());
+    app->setWindowIcon(icon());
+}
+
+QString AppStyle::styleSheet()
+{
+    return R"(
+        QMainWindow#mainWindow {
+            background-color: #1E1E2E;
+        }
+        
+        QLabel#titleLabel {
+            font-size: 22px;
+            font-weight: bold;
+            color: #E8E8E8;
+            padding: 8px;
+        }
+        
+        QPushButton#captureButton {
+            background: qlineargradient(x1:0, y1:0, x2:1, y2:1,
+                stop:0 #667eea, stop:1 #764ba2);
+            color: white;
+            border: none;
+            border-radius: 12px;
+            font-size: 15px;
+            font-weight: bold;
+            padding: 12px 24px;
+        }
+        QPushButton#captureButton:hover {
+            background: qlineargradient(x1:0, y1:0, x2:1, y2:1,
+                stop:0 #7b8ef8, stop:1 #8b5fbf);
+        }
+        QPushButton#captureButton:pressed {
+            background: qlineargradient(x1:0, y1:0, x2:1, y2:1,
+                stop:0 #5a6fd6, stop:1 #6a4190);
+        }
+        
+        QFrame#folderFrame {
+            background-color: #2A2A3C;
+            border: 1px solid #3A3A4C;
+            border-radius: 8px;
+        }
+        QLabel#folderTitle {
+            color: #B0B0C0;
+            font-size: 11px;
+            font-weight: bold;
+            border: none;
+            background: transparent;
+        }
+        QLabel#savePathLabel {
+            color: #8A8A9A;
+            font-size: 10px;
+            border: none;
+            background: transparent;
+        }
+        QLabel#savePathLabel[state="warning"] {
+            color: #F0A050;
+        }
+        QLabel#savePathLabel[state="success"] {
+            color: #4ADE80;
+        }
+        QPushButton#folderButton {
+            background-color: #3A3A4C;
+            color: #D0D0E0;
+            border: none;
+            border-radius: 6px;
+            font-size: 11px;
+            padding: 8px 16px;
+        }
+        QPushButton#folderButton:hover {
+            background-color: #4A4A5C;
+        }
+        QPushButton#folderButton:pressed {
+            background-color: #2A2A3C;
+        }
+        QComboBox#encoderCombo {
+            background-color: #3A3A4C;
+            color: #D0D0E0;
+            border: none;
+            border-radius: 6px;
+            font-size: 11px;
+            padding: 6px 12px;
+        }
+        QComboBox#encoderCombo:hover {
+            background-color: #4A4A5C;
+        }
+        QComboBox#encoderCombo::drop-down {
+            border: none;
+        }
+        QComboBox#encoderCombo QAbstractItemView {
+            background-color: #2A2A3C;
+            color: #D0D0E0;
+            selection-background-color: #4A4A5C;
+        }
+        
+        QFrame#previewFrame {
+            background-color: #2A2A3C;
+            border: 2px dashed #4A4A5C;
+            border-radius: 10px;
+        }
+        QLabel#previewLabel {
+            color: #6A6A7A;
+            font-size: 11px;
+            border: none;
+            background: transparent;
+        }
+        
+        QLabel#statusLabel {
+            color: #8A8A9A;
+            font-size: 10px;
+            padding: 4px;
+        }
+        QLabel#statusLabel[state="success"] {
+            color: #4ADE80;
+        }
+        QLabel#statusLabel[state="error"] {
+            color: #F87171;
+        }
+        
+        QPushButton#openLocationButton, QPushButton#coordPickerButton {
+            background-color: #2A2A3C;
+            border: 1px solid #3A3A4C;
+            border-radius: 6px;
+            font-size: 10px;
+            padding: 8px 12px;
+        }
+        QPushButton#openLocationButton:hover, QPushButton#coordPickerButton:hover {
+            background-color: #3A3A4C;
+        }
+        QPushButton#openLocationButton:pressed, QPushButton#coordPickerButton:pressed {
+            background-color: #1A1A2C;
+        }
+        QPushButton#openLocationButton {
+            color: #60A5FA;
+        }
+        QPushButton#openLocationButton:hover {
+            color: #93C5FD;
+        }
+        QPushButton#coordPickerButton {
+            color: #FBBF24;
+        }
+        QPushButton#coordPickerButton:hover {
+            color: #FCD34D;
+        }
+    )";
+}
+
+QIcon AppStyle::icon()
+{
+    // Decoding the .ico and probing the fallbacks happens once per run
+    static const QIcon appIcon = []() {
+        // Use the application icon (embedded in the resources)
+        QIcon icon(":/icons/cordshot.ico");
+        if (icon.isNull()) {
+            // Fallback: try loading from file next to exe
+            icon = QIcon(QApplication::applicationDirPath() + "/cordshot.ico");
+        }
+        if (icon.isNull()) {
+            // Final fallback: create a simple icon programmatically
+            QPixmap iconPixmap(32, 32);
+            iconPixmap.fill(Qt::transparent);
+            QPainter painter(&iconPixmap);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setBrush(QColor(102, 126, 234));
+            painter.setPen(Qt::NoPen);
+            painter.drawEllipse(2, 2, 28, 28);
+            painter.setBrush(Qt::white);
+            painter.drawEllipse(10, 10, 12, 12);
+            painter.end();
+            icon = QIcon(iconPixmap);
+        }
+        return icon;
+    }();
+    return appIcon;
+}
+
+void AppStyle::setState(QWidget *widget, const char *state)
+{
+    const QVariant value = state ? QVariant(QString::fromLatin1(state)) : QVariant();
+    if (widget->property("state") == value) {
+        return;
+    }
+    widget->setProperty("state", value);
+    // Property selectors are only re-evaluated on a repolish
+    widget->style()->unpolish(widget);
+    widget->style()->polish(widget);
+    widget->update();
+}
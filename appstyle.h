@@ -0,0 +1,29 @@
+#ifndef APPSTYLE_H
+#define APPSTYLE_H
+
+#include <QIcon>
+#include <QString>
+
+class QApplication;
+class QWidget;
+
+// The main window's look in one place: a single application stylesheet,
+// parsed once at startup, that styles widgets by object name, and the
+// application icon, resolved once and shared by the window and the tray.
+class AppStyle
+{
+public:
+    // Install the stylesheet and window icon before any widget exists,
+    // so each widget is polished once instead of per setStyleSheet() call
+    static void apply(QApplication *app);
+
+    static QString styleSheet();
+    static QIcon icon();
+
+    // Switch a widget between the variants the stylesheet defines for it
+    // ("success", "error", "warning"; nullptr for the default) without
+    // reparsing any stylesheet
+    static void setState(QWidget *widget, const char *state);
+};
+
+#endif // APPSTYLE_H
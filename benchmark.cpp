@@ -0,0 +1,388 @@
+// cordshot_bench: times the capture hot path on synthetic frames and
+// prints one JSON object per line, so runs can be diffed between releases.
+//
+//   cordshot_bench [--iterations N] [--case name] [--size name]
+
+#include "screenshotoverlay.h"
+#include "screencapture.h"
+#include "imageencoder.h"
+#include "coordinatepicker.h"
+#include "imageops.h"
+#include "pointstore.h"
+#include "capturefilewriter.h"
+
+#include <QApplication>
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLinearGradient>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+struct BenchSize
+{
+    const char *name;
+    int width;
+    int height;
+};
+
+// 3x4k stands in for a three-monitor desktop stitched side by side,
+// 4x4k for the 16K-wide captures the picker has to open quickly
+const BenchSize BenchSizes[] = {
+    {"1080p", 1920, 1080},
+    {"4k", 3840, 2160},
+    {"8k", 7680, 4320},
+    {"3x4k", 11520, 2160},
+    {"4x4k", 15360, 2160},
+};
+
+// Slow cases (8K PNG) stop early once this much time has been spent
+const qint64 CaseBudgetNs = 3000000000LL;
+
+// Same size as the preview box in MainWindow
+const QSize PreviewSize(230, 74);
+
+class Bench
+{
+public:
+    Bench(int iterations, const QString &caseFilter, const QString &sizeFilter)
+        : m_iterations(iterations)
+        , m_caseFilter(caseFilter)
+        , m_sizeFilter(sizeFilter)
+        , m_out(stdout)
+    {
+    }
+    
+    bool wantsSize(const QString &size) const
+    {
+        return m_sizeFilter.isEmpty() || m_sizeFilter == size;
+    }
+    
+    void printEnvironment()
+    {
+        QJsonObject record;
+        record["type"] = "environment";
+        record["cordshot"] = QCoreApplication::applicationVersion();
+        record["qt"] = QString::fromLatin1(qVersion());
+        record["platform"] = QGuiApplication::platformName();
+        record["threads"] = QThread::idealThreadCount();
+        record["iterations"] = m_iterations;
+        print(record);
+    }
+    
+    // Run job up to m_iterations times and print min/median/mean, plus
+    // whatever details() returns afterwards
+    void run(const QString &name, const QString &size, const QSize &pixels,
+             const std::function<void()> &job,
+             const std::function<QJsonObject()> &details = nullptr)
+    {
+        if (!m_caseFilter.isEmpty() && m_caseFilter != name) {
+            return;
+        }
+        
+        QVector<qint64> samples;
+        qint64 totalNs = 0;
+        QElapsedTimer timer;
+        while (samples.size() < m_iterations && (samples.isEmpty() || totalNs < CaseBudgetNs)) {
+            timer.start();
+            job();
+            const qint64 ns = timer.nsecsElapsed();
+            samples.append(ns);
+            totalNs += ns;
+        }
+        std::sort(samples.begin(), samples.end());
+        
+        QJsonObject record = details ? details() : QJsonObject();
+        record["type"] = "result";
+        record["case"] = name;
+        record["size"] = size;
+        record["width"] = pixels.width();
+        record["height"] = pixels.height();
+        record["iterations"] = samples.size();
+        record["min_ms"] = samples.first() / 1e6;
+        record["median_ms"] = samples.at(samples.size() / 2) / 1e6;
+        record["mean_ms"] = totalNs / 1e6 / samples.size();
+        print(record);
+    }
+
+private:
+    void print(const QJsonObject &record)
+    {
+        m_out << QJsonDocument(record).toJson(QJsonDocument::Compact) << "\n";
+        m_out.flush();
+    }
+    
+    int m_iterations;
+    QString m_caseFilter;
+    QString m_sizeFilter;
+    QTextStream m_out;
+};
+
+// Something that compresses like a desktop: flat panels, gradients and
+// rows of small high-contrast detail standing in for text
+QImage syntheticDesktop(int width, int height)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    QPainter painter(&image);
+    
+    QLinearGradient background(0, 0, width, height);
+    background.setColorAt(0.0, QColor(32, 36, 52));
+    background.setColorAt(1.0, QColor(70, 60, 110));
+    painter.fillRect(image.rect(), background);
+    
+    QRandomGenerator random(1234);
+    const int windows = qMax(4, width * height / 400000);
+    for (int i = 0; i < windows; ++i) {
+        const QRect window(random.bounded(width), random.bounded(height),
+                           200 + random.bounded(width / 3), 150 + random.bounded(height / 3));
+        painter.fillRect(window, QColor::fromRgb(random.generate() | 0xff000000).lighter(150));
+        painter.fillRect(window.adjusted(0, 0, 0, 28 - window.height()), QColor(45, 45, 60));
+        
+        painter.setPen(Qt::black);
+        for (int y = window.top() + 40; y < window.bottom() - 10; y += 18) {
+            for (int x = window.left() + 10; x < window.right() - 40; x += 8 + random.bounded(30)) {
+                painter.drawLine(x, y, x + 4 + random.bounded(24), y);
+            }
+        }
+    }
+    painter.end();
+    return image;
+}
+
+void benchGrab(Bench &bench)
+{
+    // The offscreen platform has its own screen size, reported as-is
+    CapturedFrame frame = ScreenCapture::grabVirtualDesktop();
+    bench.run("screen_grab", "screen", frame.image.size(), []() {
+        ScreenCapture::grabVirtualDesktop();
+    });
+}
+
+void benchSize(Bench &bench, const BenchSize &size)
+{
+    const QImage image = syntheticDesktop(size.width, size.height);
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    const QSize pixels = image.size();
+    
+    // takeScreenshot() copies the selection out of the captured frame so
+    // the clipboard does not pin the frame; the zero-copy view and the
+    // QPixmap crop it replaced are measured alongside
+    const QRect selection(pixels.width() / 4, pixels.height() / 4,
+                          pixels.width() / 2, pixels.height() / 2);
+    bench.run("region_view", size.name, pixels, [&]() {
+        QImage view = ImageOps::regionView(image, selection);
+        Q_UNUSED(view);
+    });
+    bench.run("region_image_copy", size.name, pixels, [&]() {
+        QImage owned = image.copy(selection);
+        Q_UNUSED(owned);
+    });
+    bench.run("region_copy", size.name, pixels, [&]() {
+        QPixmap crop = pixmap.copy(selection);
+        crop.setDevicePixelRatio(1.0);
+    });
+    
+    // Encoders as used by the save queue, into memory to leave disk out
+    for (ImageEncoder::Preset preset : ImageEncoder::availablePresets()) {
+        qint64 bytes = 0;
+        bench.run("encode_" + ImageEncoder::key(preset), size.name, pixels, [&]() {
+            QBuffer buffer;
+            buffer.open(QIODevice::WriteOnly);
+            bytes = ImageEncoder::encode(image, &buffer, ImageEncoder::fileSuffix(preset),
+                                         preset).bytes;
+        }, [&]() {
+            QJsonObject details;
+            details["bytes"] = bytes;
+            return details;
+        });
+    }
+    
+    // MainWindow::onScreenshotTaken(): preview thumbnail, as the
+    // Downscaler makes it, against Qt's smooth scaling it replaced
+    bench.run("preview_scale", size.name, pixels, [&]() {
+        QImage preview = ImageOps::downscaled(image, PreviewSize);
+        Q_UNUSED(preview);
+    });
+    bench.run("preview_scale_qt", size.name, pixels, [&]() {
+        QImage preview = image.scaled(PreviewSize, Qt::KeepAspectRatio,
+                                      Qt::SmoothTransformation);
+        Q_UNUSED(preview);
+    });
+    
+    // Opening the picker: ClickableImageLabel::setImage() and the first
+    // paint, which draws the stand-in preview and queues visible tiles
+    ClickableImageLabel label;
+    label.resize(1920, 1080);
+    const QImage view = ImageOps::regionView(image, image.rect());
+    QImage pickerTarget(label.size(), QImage::Format_ARGB32_Premultiplied);
+    bench.run("picker_open", size.name, pixels, [&]() {
+        label.setImage(view);
+        label.render(&pickerTarget);
+    });
+    
+    // ScreenshotOverlay: building the layers once per arm, then a full
+    // repaint with a selection in progress
+    ScreenshotOverlay overlay;
+    CapturedFrame frame;
+    frame.image = image;
+    frame.geometry = QRect(QPoint(0, 0), pixels);
+    bench.run("overlay_load_frame", size.name, pixels, [&]() {
+        overlay.loadFrame(frame);
+    });
+    
+    QMouseEvent press(QEvent::MouseButtonPress, selection.topLeft(), selection.topLeft(),
+                      Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QMouseEvent move(QEvent::MouseMove, selection.bottomRight(), selection.bottomRight(),
+                     Qt::NoButton, Qt::LeftButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(&overlay, &press);
+    QCoreApplication::sendEvent(&overlay, &move);
+    
+    QImage target(pixels, QImage::Format_ARGB32_Premultiplied);
+    bench.run("overlay_paint", size.name, pixels, [&]() {
+        overlay.render(&target);
+    });
+}
+
+// Picker click maps: each case does 1000 operations on a 50k point store
+void benchPoints(Bench &bench)
+{
+    const QSize area(7680, 4320);
+    QRandomGenerator random(42);
+    QVector<QPoint> points(50000);
+    for (QPoint &point : points) {
+        point = QPoint(random.bounded(area.width()), random.bounded(area.height()));
+    }
+    
+    PointStore store;
+    bench.run("points_import", "50k", area, [&]() {
+        store.clear();
+        store.append(points);
+    });
+    bench.run("points_add_1000", "50k", area, [&]() {
+        for (int i = 0; i < 1000; ++i) {
+            store.append(QPoint(random.bounded(area.width()), random.bounded(area.height())));
+        }
+    });
+    bench.run("points_hit_test_1000", "50k", area, [&]() {
+        for (int i = 0; i < 1000; ++i) {
+            store.findNear(QPointF(random.bounded(area.width()), random.bounded(area.height())), 12);
+        }
+    });
+    bench.run("points_remove_1000", "50k", area, [&]() {
+        for (int i = 0; i < 1000; ++i) {
+            store.removeAt(random.bounded(store.count()));
+        }
+    });
+}
+
+// Saving bursts of captures: each case publishes 200 files of 256 KB,
+// the size of a compressed 1080p PNG, into a fresh folder
+void benchFiles(Bench &bench)
+{
+    const int files = 200;
+    const QByteArray data(256 * 1024, 'x');
+    const QSize area(1920, 1080);
+    
+    // Plain overwrite in place, what the save queue did before
+    QTemporaryDir directDir;
+    bench.run("file_write_direct", "200x256k", area, [&]() {
+        for (int i = 0; i < files; ++i) {
+            QFile file(directDir.filePath(QString("frame_%1.png").arg(i)));
+            file.open(QIODevice::WriteOnly);
+            file.write(data);
+        }
+    });
+    
+    for (CaptureFileWriter::SyncPolicy policy : {CaptureFileWriter::NoSync,
+                                                 CaptureFileWriter::SyncFile,
+                                                 CaptureFileWriter::SyncDirectory}) {
+        CaptureFileWriter::Options options;
+        options.sync = policy;
+        options.replace = false;
+        
+        QTemporaryDir dir;
+        qint64 written = 0;
+        QElapsedTimer timer;
+        qint64 totalNs = 0;
+        bench.run("file_write_" + CaptureFileWriter::key(policy), "200x256k", area, [&]() {
+            timer.start();
+            for (int i = 0; i < files; ++i) {
+                QString path = CaptureFileWriter::uniquePath(dir.path(), "screenshot", ".png");
+                written += CaptureFileWriter::write(data, &path, options) ? 1 : 0;
+            }
+            totalNs += timer.nsecsElapsed();
+        }, [&]() {
+            QJsonObject details;
+            details["files_per_s"] = totalNs > 0 ? written * 1e9 / totalNs : 0.0;
+            return details;
+        });
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Runs headless by default so it works on CI machines
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    
+    QCoreApplication::setApplicationName("cordshot_bench");
+    QCoreApplication::setApplicationVersion("1.1.0");
+    QApplication app(argc, argv);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Time cordshot's capture hot path on synthetic frames. "
+                                     "Prints one JSON object per line.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption iterationsOption("iterations",
+        "Samples per case (fewer for cases slower than 3 s in total). Defaults to 5.", "N", "5");
+    QCommandLineOption caseOption("case",
+        "Only run this case, e.g. overlay_paint.", "name");
+    QCommandLineOption sizeOption("size",
+        "Only run this size: 1080p, 4k, 8k, 3x4k, 4x4k, screen, 50k for the point store, "
+        "or 200x256k for file writes.", "name");
+    parser.addOptions({iterationsOption, caseOption, sizeOption});
+    parser.process(app);
+    
+    bool ok = false;
+    const int iterations = parser.value(iterationsOption).toInt(&ok);
+    if (!ok || iterations <= 0) {
+        QTextStream(stderr) << "cordshot_bench: --iterations expects a positive number\n";
+        return 1;
+    }
+    
+    Bench bench(iterations, parser.value(caseOption), parser.value(sizeOption));
+    bench.printEnvironment();
+    
+    if (bench.wantsSize("screen")) {
+        benchGrab(bench);
+    }
+    for (const BenchSize &size : BenchSizes) {
+        if (bench.wantsSize(size.name)) {
+            benchSize(bench, size);
+        }
+    }
+    if (bench.wantsSize("50k")) {
+        benchPoints(bench);
+    }
+    if (bench.wantsSize("200x256k")) {
+        benchFiles(bench);
+    }
+    
+    return 0;
+}
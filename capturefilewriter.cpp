@@ -0,0 +1,293 @@
+#include "capturefilewriter.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// The millisecond uniquePath() last named, and how many names it got
+QMutex sequenceMutex;
+qint64 sequenceMs = -1;
+int sequenceCount = 0;
+
+// Give up on free names after this many, rather than loop forever
+const int MaxNumberedNames = 1000;
+
+enum PublishResult {
+    Published,
+    Exists,
+    Failed
+};
+
+#ifndef Q_OS_WIN
+// umask() can only be read by setting it, which would race with threads
+// creating files, so it is read once while static initialisers run
+mode_t readUmask()
+{
+    const mode_t mask = ::umask(0);
+    ::umask(mask);
+    return mask;
+}
+
+const mode_t processUmask = readUmask();
+#endif
+
+// QTemporaryFile creates its file owner-only, and the rename keeps that.
+// Give the data the mode a plain QFile write would have: the replaced
+// file's, or the default for new files. Best effort: filesystems without
+// Unix modes (vfat, exFAT) refuse the change, and the file is no less
+// written for it.
+void setPublishedPermissions(QFile &file, const QString &target, bool replace)
+{
+#ifdef Q_OS_WIN
+    // New files inherit the folder's ACL like any other
+    Q_UNUSED(file);
+    Q_UNUSED(target);
+    Q_UNUSED(replace);
+#else
+    mode_t mode = 0666 & ~processUmask;
+    struct stat existing;
+    if (replace && ::stat(QFile::encodeName(target).constData(), &existing) == 0) {
+        mode = existing.st_mode & 07777;
+    }
+    // A refusal (EPERM, ENOTSUP) leaves the mount's own mode in place
+    ::fchmod(file.handle(), mode);
+#endif
+}
+
+bool syncFile(QFile &file)
+{
+#ifdef Q_OS_WIN
+    const HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()));
+    return handle != INVALID_HANDLE_VALUE && FlushFileBuffers(handle);
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool syncDirectory(const QString &path)
+{
+#ifdef Q_OS_WIN
+    // NTFS journals the rename itself and has no folder handle to flush
+    Q_UNUSED(path);
+    return true;
+#else
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+PublishResult publish(const QString &from, const QString &to, bool replace, bool writeThrough)
+{
+#ifdef Q_OS_WIN
+    // Write-through makes the move wait for the disk, so only when asked
+    DWORD flags = writeThrough ? MOVEFILE_WRITE_THROUGH : 0;
+    if (replace) {
+        flags |= MOVEFILE_REPLACE_EXISTING;
+    }
+    if (MoveFileExW(reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(from).utf16()),
+                    reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(to).utf16()),
+                    flags)) {
+        return Published;
+    }
+    const DWORD error = GetLastError();
+    return error == ERROR_ALREADY_EXISTS || error == ERROR_FILE_EXISTS ? Exists : Failed;
+#else
+    Q_UNUSED(writeThrough);
+    const QByteArray source = QFile::encodeName(from);
+    const QByteArray target = QFile::encodeName(to);
+    if (replace) {
+        return ::rename(source.constData(), target.constData()) == 0 ? Published : Failed;
+    }
+    
+    // Unlike rename(), link() fails instead of replacing, in one step
+    if (::link(source.constData(), target.constData()) == 0) {
+        ::unlink(source.constData());
+        return Published;
+    }
+    if (errno == EEXIST) {
+        return Exists;
+    }
+    
+    // Filesystems without hard links (FAT, some network shares)
+    if (QFileInfo::exists(to)) {
+        return Exists;
+    }
+    return ::rename(source.constData(), target.constData()) == 0 ? Published : Failed;
+#endif
+}
+
+// shot.png -> shot_2.png
+QString numberedPath(const QString &filePath, int number)
+{
+    const QFileInfo info(filePath);
+    QString name = QString("%1_%2").arg(info.completeBaseName()).arg(number);
+    if (!info.suffix().isEmpty()) {
+        name += "." + info.suffix();
+    }
+    return info.dir().filePath(name);
+}
+
+} // namespace
+
+QString CaptureFileWriter::uniquePath(const QString &directory, const QString &prefix,
+                                      const QString &suffix, Sharding sharding,
+                                      const QDateTime &time)
+{
+    QString folder = directory;
+    if (sharding == MonthlyShards) {
+        folder += "/" + time.toString("yyyy-MM");
+    } else if (sharding == DailyShards) {
+        folder += "/" + time.toString("yyyy-MM-dd");
+    }
+    
+    int count;
+    {
+        QMutexLocker locker(&sequenceMutex);
+        const qint64 ms = time.toMSecsSinceEpoch();
+        if (ms != sequenceMs) {
+            sequenceMs = ms;
+            sequenceCount = 0;
+        }
+        count = ++sequenceCount;
+    }
+    
+    QString name = prefix + "_" + time.toString("yyyy-MM-dd_hh-mm-ss-zzz");
+    if (count > 1) {
+        name += QString("_%1").arg(count);
+    }
+    return folder + "/" + name + suffix;
+}
+
+bool CaptureFileWriter::write(const QByteArray &data, QString *filePath, const Options &options,
+                              QString *error)
+{
+    const QFileInfo info(*filePath);
+    const QString directory = info.absolutePath();
+    if (!QDir().mkpath(directory)) {
+        if (error) {
+            *error = "Cannot create folder " + directory;
+        }
+        return false;
+    }
+    
+    // Hidden, and with a suffix of its own so globs for the real one skip
+    // it. Removed again on any failure below.
+    QTemporaryFile temp(QDir(directory).filePath("." + info.fileName() + ".XXXXXX.part"));
+    if (!temp.open()) {
+        if (error) {
+            *error = temp.errorString();
+        }
+        return false;
+    }
+    
+    bool ok = temp.write(data) == data.size() && temp.flush();
+    if (!ok) {
+        if (error) {
+            *error = temp.errorString();
+        }
+        return false;
+    }
+    setPublishedPermissions(temp, *filePath, options.replace);
+    if (options.sync != NoSync && !syncFile(temp)) {
+        if (error) {
+            *error = "Cannot sync " + temp.fileName() + ": " + qt_error_string();
+        }
+        return false;
+    }
+    const QString tempPath = temp.fileName();
+    temp.close();
+    
+    QString target = *filePath;
+    for (int number = 2; ; ++number) {
+        const PublishResult result = publish(tempPath, target, options.replace,
+                                             options.sync != NoSync);
+        if (result == Published) {
+            break;
+        }
+        if (result == Failed || number > MaxNumberedNames) {
+            if (error) {
+                *error = "Cannot move the file into place: " + qt_error_string();
+            }
+            return false;
+        }
+        target = numberedPath(*filePath, number);
+    }
+    temp.setAutoRemove(false);
+    *filePath = target;
+    
+    if (options.sync == SyncDirectory && !syncDirectory(directory)) {
+        if (error) {
+            *error = "Cannot sync folder " + directory + ": " + qt_error_string();
+        }
+        return false;
+    }
+    return true;
+}
+
+QString CaptureFileWriter::key(SyncPolicy policy)
+{
+    switch (policy) {
+    case SyncFile:
+        return "file";
+    case SyncDirectory:
+        return "directory";
+    case NoSync:
+        break;
+    }
+    return "none";
+}
+
+CaptureFileWriter::SyncPolicy CaptureFileWriter::syncPolicyFromKey(const QString &key,
+                                                                   SyncPolicy fallback)
+{
+    for (SyncPolicy policy : {NoSync, SyncFile, SyncDirectory}) {
+        if (key == CaptureFileWriter::key(policy)) {
+            return policy;
+        }
+    }
+    return fallback;
+}
+
+QString CaptureFileWriter::key(Sharding sharding)
+{
+    switch (sharding) {
+    case MonthlyShards:
+        return "monthly";
+    case DailyShards:
+        return "daily";
+    case NoShards:
+        break;
+    }
+    return "none";
+}
+
+CaptureFileWriter::Sharding CaptureFileWriter::shardingFromKey(const QString &key,
+                                                               Sharding fallback)
+{
+    for (Sharding sharding : {NoShards, MonthlyShards, DailyShards}) {
+        if (key == CaptureFileWriter::key(sharding)) {
+            return sharding;
+        }
+    }
+    return fallback;
+}
@@ -0,0 +1,56 @@
+#ifndef CAPTUREFILEWRITER_H
+#define CAPTUREFILEWRITER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+// Names and publishes capture files. Names carry milliseconds plus a
+// sequence, so captures in the same second (or millisecond) never share
+// one. Files are written to a hidden temp file in the target folder and
+// renamed into place, so a folder watcher or a script never sees one half
+// written. How hard the data is pushed to disk first is a SyncPolicy.
+class CaptureFileWriter
+{
+public:
+    enum SyncPolicy {
+        NoSync,             // Leave write-back to the OS; fastest
+        SyncFile,           // fsync the data before it is renamed into place
+        SyncDirectory       // Also fsync the folder so the new name is durable
+    };
+
+    // Subfolders that keep a save folder quick to list as it grows
+    enum Sharding {
+        NoShards,
+        MonthlyShards,      // yyyy-MM
+        DailyShards         // yyyy-MM-dd
+    };
+
+    struct Options
+    {
+        SyncPolicy sync = NoSync;
+        // Off: an existing file is never overwritten, the data gets the
+        // next free name instead
+        bool replace = true;
+    };
+
+    // <directory>/[<shard>/]<prefix>_yyyy-MM-dd_hh-mm-ss-zzz<suffix>, plus
+    // _2, _3... for further names handed out in the same millisecond.
+    // Thread-safe; the folder is created by write().
+    static QString uniquePath(const QString &directory, const QString &prefix,
+                              const QString &suffix, Sharding sharding = NoShards,
+                              const QDateTime &time = QDateTime::currentDateTime());
+
+    // Atomically publish data at *filePath, creating its folder if needed.
+    // *filePath is updated when the data had to take another name.
+    static bool write(const QByteArray &data, QString *filePath,
+                      const Options &options = Options(), QString *error = nullptr);
+
+    // Stable names stored in QSettings and accepted on the command line
+    static QString key(SyncPolicy policy);
+    static SyncPolicy syncPolicyFromKey(const QString &key, SyncPolicy fallback = NoSync);
+    static QString key(Sharding sharding);
+    static Sharding shardingFromKey(const QString &key, Sharding fallback = NoShards);
+};
+
+#endif // CAPTUREFILEWRITER_H
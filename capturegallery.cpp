@@ -0,0 +1,138 @@
+#include "capturegallery.h"
+#include "capturehistory.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFileInfo>
+
+CaptureGallery::CaptureGallery(CaptureHistory *history, QWidget *parent)
+    : QDialog(parent)
+    , m_history(history)
+{
+    setWindowTitle("Capture History");
+    resize(620, 460);
+    
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(16, 16, 16, 16);
+    mainLayout->setSpacing(10);
+    
+    m_list = new QListWidget(this);
+    m_list->setViewMode(QListView::IconMode);
+    m_list->setIconSize(QSize(160, 100));
+    m_list->setGridSize(QSize(184, 150));
+    m_list->setResizeMode(QListView::Adjust);
+    m_list->setMovement(QListView::Static);
+    m_list->setUniformItemSizes(true);
+    m_list->setStyleSheet(R"(
+        QListWidget {
+            color: #D0D0E0;
+            font-size: 11px;
+            background-color: #1A1A2A;
+            border: 2px solid #3A3A4C;
+            border-radius: 8px;
+        }
+        QListWidget::item:selected {
+            background-color: #3A3A4C;
+            color: #FFFFFF;
+        }
+    )");
+    connect(m_list, &QListWidget::itemSelectionChanged, this, &CaptureGallery::onSelectionChanged);
+    connect(m_list, &QListWidget::itemActivated, this, &CaptureGallery::requestPicker);
+    mainLayout->addWidget(m_list, 1);
+    
+    m_statsLabel = new QLabel(this);
+    m_statsLabel->setStyleSheet(R"(
+        QLabel {
+            color: #8A8A9A;
+            font-size: 11px;
+            padding: 4px;
+        }
+    )");
+    mainLayout->addWidget(m_statsLabel);
+    
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->setSpacing(8);
+    
+    m_pickerButton = new QPushButton("📍 Get Coordinates", this);
+    m_pickerButton->setEnabled(false);
+    m_pickerButton->setCursor(Qt::PointingHandCursor);
+    m_pickerButton->setStyleSheet(R"(
+        QPushButton {
+            background-color: #3A3A4C;
+            color: #FBBF24;
+            border: none;
+            border-radius: 6px;
+            font-size: 12px;
+            padding: 10px 16px;
+        }
+        QPushButton:hover {
+            background-color: #4A4A5C;
+            color: #FCD34D;
+        }
+        QPushButton:disabled {
+            background-color: #2A2A3C;
+            color: #5A5A6A;
+        }
+    )");
+    connect(m_pickerButton, &QPushButton::clicked, this, &CaptureGallery::requestPicker);
+    buttonLayout->addWidget(m_pickerButton);
+    
+    buttonLayout->addStretch();
+    
+    QPushButton *closeButton = new QPushButton("Close", this);
+    closeButton->setCursor(Qt::PointingHandCursor);
+    closeButton->setStyleSheet(m_pickerButton->styleSheet());
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+    buttonLayout->addWidget(closeButton);
+    
+    mainLayout->addLayout(buttonLayout);
+    
+    setStyleSheet(R"(
+        QDialog {
+            background-color: #1E1E2E;
+        }
+    )");
+    
+    connect(m_history, &CaptureHistory::changed, this, &CaptureGallery::refresh);
+    refresh();
+}
+
+void CaptureGallery::refresh()
+{
+    const int selectedId = m_list->currentItem()
+        ? m_list->currentItem()->data(Qt::UserRole).toInt() : 0;
+    
+    m_list->clear();
+    for (const CaptureHistory::Entry &entry : m_history->entries()) {
+        QString text = QString("%1×%2  %3")
+            .arg(entry.size.width())
+            .arg(entry.size.height())
+            .arg(entry.taken.toString("hh:mm:ss"));
+        if (!entry.resident) {
+            text += entry.filePath.isEmpty() ? "\nspilled" : "\non disk";
+        }
+        
+        QListWidgetItem *item = new QListWidgetItem(QIcon(QPixmap::fromImage(entry.thumbnail)), text);
+        item->setData(Qt::UserRole, entry.id);
+        item->setToolTip(entry.filePath.isEmpty() ? QString("Clipboard only")
+                                                  : QFileInfo(entry.filePath).fileName());
+        m_list->addItem(item);
+        if (entry.id == selectedId) {
+            m_list->setCurrentItem(item);
+        }
+    }
+    
+    m_statsLabel->setText(m_history->statsText());
+    onSelectionChanged();
+}
+
+void CaptureGallery::onSelectionChanged()
+{
+    m_pickerButton->setEnabled(m_list->currentItem() != nullptr);
+}
+
+void CaptureGallery::requestPicker()
+{
+    if (QListWidgetItem *item = m_list->currentItem()) {
+        emit pickerRequested(item->data(Qt::UserRole).toInt());
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CAPTUREGALLERY_H
+#define CAPTUREGALLERY_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QListWidget>
+#include <QPushButton>
+
+class CaptureHistory;
+
+// Thumbnails of the capture history, newest first. Only the resident
+// thumbnails are shown, so opening it never waits on the disk; picking a
+// capture asks the main window to open the coordinate picker on it.
+class CaptureGallery : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit CaptureGallery(CaptureHistory *history, QWidget *parent = nullptr);
+
+signals:
+    void pickerRequested(int captureId);
+
+private slots:
+    void refresh();
+    void onSelectionChanged();
+    void requestPicker();
+
+private:
+    CaptureHistory *m_history;
+    QListWidget *m_list;
+    QLabel *m_statsLabel;
+    QPushButton *m_pickerButton;
+};
+
+#endif // CAPTUREGALLERY_H
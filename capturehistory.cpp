@@ -0,0 +1,453 @@
+#include "capturehistory.h"
+#include "downscaler.h"
+#include <QThreadPool>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QImageReader>
+#include <cstring>
+
+namespace {
+
+const QSize ThumbnailSize(160, 100);
+
+// Raw spill files: this header, then the scanlines packed. They only
+// ever live in this process's temp directory, so native byte order.
+struct SpillHeader
+{
+    char magic[4];
+    quint32 width;
+    quint32 height;
+    quint32 format;
+    quint32 lineBytes;
+};
+
+bool writeSpill(const QImage &image, const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    
+    const SpillHeader header = {{'C', 'S', 'R', 'W'}, quint32(image.width()), quint32(image.height()),
+                                quint32(image.format()),
+                                quint32((image.width() * image.depth() + 7) / 8)};
+    bool ok = file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header);
+    
+    // A view into a wider frame has padding between lines; skip it
+    if (image.bytesPerLine() == qsizetype(header.lineBytes)) {
+        const qint64 bytes = qint64(header.lineBytes) * image.height();
+        ok = ok && file.write(reinterpret_cast<const char *>(image.constBits()), bytes) == bytes;
+    } else {
+        for (int y = 0; ok && y < image.height(); ++y) {
+            ok = file.write(reinterpret_cast<const char *>(image.constScanLine(y)),
+                            header.lineBytes) == qint64(header.lineBytes);
+        }
+    }
+    if (!ok) {
+        file.remove();
+    }
+    return ok;
+}
+
+QImage readSpill(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return QImage();
+    }
+    
+    SpillHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+        || std::memcmp(header.magic, "CSRW", 4) != 0) {
+        *error = "Spill file is damaged";
+        return QImage();
+    }
+    
+    QImage image(int(header.width), int(header.height), QImage::Format(header.format));
+    if (image.isNull()) {
+        *error = "Not enough memory to reload the capture";
+        return QImage();
+    }
+    for (int y = 0; y < image.height(); ++y) {
+        if (file.read(reinterpret_cast<char *>(image.scanLine(y)), header.lineBytes)
+            != qint64(header.lineBytes)) {
+            *error = "Spill file is truncated";
+            return QImage();
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+CaptureHistory::CaptureHistory(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_downscaler(new Downscaler(this))
+    , m_budget(512LL * 1024 * 1024)
+    , m_residentBytes(0)
+    , m_maxEntries(50)
+    , m_nextId(1)
+    , m_clock(0)
+    , m_spills(0)
+    , m_reloads(0)
+{
+    // Spills and reloads are disk bound; one at a time keeps them in order
+    m_pool->setMaxThreadCount(1);
+    connect(m_downscaler, &Downscaler::scaled, this, &CaptureHistory::onThumbnailScaled);
+}
+
+CaptureHistory::~CaptureHistory()
+{
+    // Jobs post back to this object and write into the spill directory
+    m_pool->waitForDone();
+}
+
+void CaptureHistory::setMemoryBudget(qint64 bytes)
+{
+    m_budget = qMax<qint64>(0, bytes);
+    enforceLimits();
+}
+
+qint64 CaptureHistory::memoryBudget() const
+{
+    return m_budget;
+}
+
+void CaptureHistory::setMaxEntries(int count)
+{
+    m_maxEntries = qMax(1, count);
+    enforceLimits();
+    emit changed();
+}
+
+int CaptureHistory::add(const QImage &image, qreal devicePixelRatio)
+{
+    Record record;
+    record.entry.id = m_nextId++;
+    record.entry.taken = QDateTime::currentDateTime();
+    record.entry.size = image.size();
+    record.entry.devicePixelRatio = devicePixelRatio;
+    m_records.append(record);
+    m_thumbnailRequests.insert(m_downscaler->request(image, ThumbnailSize), record.entry.id);
+    
+    Record *added = &m_records.last();
+    setImage(added, image);
+    touch(added);
+    const int id = added->entry.id;
+    
+    enforceLimits();
+    emit changed();
+    return id;
+}
+
+void CaptureHistory::setSavePending(int id, bool pending)
+{
+    if (Record *record = find(id)) {
+        record->savePending = pending;
+        if (!pending) {
+            enforceLimits();
+        }
+    }
+}
+
+void CaptureHistory::setSavedPath(int id, const QString &filePath)
+{
+    if (Record *record = find(id)) {
+        record->entry.filePath = filePath;
+        record->savePending = false;
+        enforceLimits();
+        emit changed();
+    }
+}
+
+int CaptureHistory::count() const
+{
+    return m_records.size();
+}
+
+bool CaptureHistory::contains(int id) const
+{
+    return find(id) != nullptr;
+}
+
+CaptureHistory::Entry CaptureHistory::entry(int id) const
+{
+    const Record *record = find(id);
+    if (!record) {
+        return Entry();
+    }
+    Entry result = record->entry;
+    result.resident = !record->image.isNull();
+    return result;
+}
+
+QVector<CaptureHistory::Entry> CaptureHistory::entries() const
+{
+    QVector<Entry> result;
+    result.reserve(m_records.size());
+    for (int i = m_records.size() - 1; i >= 0; --i) {
+        Entry entry = m_records.at(i).entry;
+        entry.resident = !m_records.at(i).image.isNull();
+        result.append(entry);
+    }
+    return result;
+}
+
+QImage CaptureHistory::residentImage(int id)
+{
+    Record *record = find(id);
+    if (!record || record->image.isNull()) {
+        return QImage();
+    }
+    touch(record);
+    return record->image;
+}
+
+void CaptureHistory::requestImage(int id)
+{
+    Record *record = find(id);
+    if (!record) {
+        QMetaObject::invokeMethod(this, [this, id]() {
+            emit imageFailed(id, "The capture is no longer in the history");
+        }, Qt::QueuedConnection);
+        return;
+    }
+    
+    touch(record);
+    if (!record->image.isNull()) {
+        const QImage image = record->image;
+        QMetaObject::invokeMethod(this, [this, id, image]() {
+            emit imageReady(id, image);
+        }, Qt::QueuedConnection);
+        return;
+    }
+    if (record->loading) {
+        return;
+    }
+    
+    record->loading = true;
+    const QString spillPath = record->spillPath;
+    const QString filePath = record->entry.filePath;
+    m_pool->start([this, id, spillPath, filePath]() {
+        QString error;
+        QImage image;
+        if (!spillPath.isEmpty()) {
+            image = readSpill(spillPath, &error);
+        } else {
+            QImageReader reader(filePath);
+            image = reader.read();
+            if (image.isNull()) {
+                error = reader.errorString();
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, id, image, error]() {
+            onLoaded(id, image, error);
+        }, Qt::QueuedConnection);
+    });
+}
+
+qint64 CaptureHistory::residentBytes() const
+{
+    return m_residentBytes;
+}
+
+QString CaptureHistory::statsText() const
+{
+    int resident = 0;
+    for (const Record &record : m_records) {
+        if (!record.image.isNull()) {
+            ++resident;
+        }
+    }
+    return QString("%1 captures, %2 in memory • %3 / %4 MB • %5 spilled, %6 reloaded")
+        .arg(m_records.size())
+        .arg(resident)
+        .arg((m_residentBytes + 512 * 1024) / (1024 * 1024))
+        .arg(m_budget / (1024 * 1024))
+        .arg(m_spills)
+        .arg(m_reloads);
+}
+
+CaptureHistory::Record *CaptureHistory::find(int id)
+{
+    for (Record &record : m_records) {
+        if (record.entry.id == id) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+const CaptureHistory::Record *CaptureHistory::find(int id) const
+{
+    for (const Record &record : m_records) {
+        if (record.entry.id == id) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+void CaptureHistory::touch(Record *record)
+{
+    record->lastUsed = ++m_clock;
+}
+
+void CaptureHistory::setImage(Record *record, const QImage &image)
+{
+    dropImage(record);
+    record->image = image;
+    record->cost = image.sizeInBytes();
+    m_residentBytes += record->cost;
+}
+
+void CaptureHistory::dropImage(Record *record)
+{
+    m_residentBytes -= record->cost;
+    record->image = QImage();
+    record->cost = 0;
+}
+
+bool CaptureHistory::canReload(const Record &record) const
+{
+    if (!record.spillPath.isEmpty()) {
+        return true;
+    }
+    if (record.entry.filePath.isEmpty()) {
+        return false;
+    }
+    // QOI and other formats we only write cannot be read back
+    const QByteArray suffix = QFileInfo(record.entry.filePath).suffix().toLower().toLatin1();
+    return QImageReader::supportedImageFormats().contains(suffix);
+}
+
+void CaptureHistory::enforceLimits()
+{
+    while (m_records.size() > m_maxEntries) {
+        removeOldest();
+    }
+    
+    // Bytes already on their way to a spill file are not counted twice
+    qint64 excess = m_residentBytes - m_budget;
+    quint64 newest = 0;
+    for (const Record &record : m_records) {
+        newest = qMax(newest, record.lastUsed);
+        if (record.spilling) {
+            excess -= record.cost;
+        }
+    }
+    
+    while (excess > 0) {
+        // Least recently used, never the capture in use right now
+        Record *victim = nullptr;
+        for (Record &record : m_records) {
+            if (record.image.isNull() || record.spilling || record.lastUsed == newest) {
+                continue;
+            }
+            if (!canReload(record) && (record.savePending || record.spillFailed)) {
+                continue;
+            }
+            if (!victim || record.lastUsed < victim->lastUsed) {
+                victim = &record;
+            }
+        }
+        if (!victim) {
+            break;
+        }
+        
+        excess -= victim->cost;
+        if (canReload(*victim)) {
+            dropImage(victim);
+        } else {
+            startSpill(victim);
+        }
+    }
+}
+
+void CaptureHistory::startSpill(Record *record)
+{
+    if (!m_spillDir) {
+        m_spillDir.reset(new QTemporaryDir(QDir::tempPath() + "/cordshot-spill-XXXXXX"));
+    }
+    if (!m_spillDir->isValid()) {
+        record->spillFailed = true;
+        return;
+    }
+    
+    record->spilling = true;
+    const int id = record->entry.id;
+    const QImage image = record->image;
+    const QString path = m_spillDir->filePath(QString("capture-%1.raw").arg(id));
+    m_pool->start([this, id, image, path]() {
+        const bool ok = writeSpill(image, path);
+        QMetaObject::invokeMethod(this, [this, id, path, ok]() {
+            onSpilled(id, path, ok);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CaptureHistory::onSpilled(int id, const QString &path, bool ok)
+{
+    Record *record = find(id);
+    if (!record) {
+        // Forgotten while the spill was being written
+        QFile::remove(path);
+        return;
+    }
+    
+    record->spilling = false;
+    if (ok) {
+        record->spillPath = path;
+        ++m_spills;
+    } else {
+        record->spillFailed = true;
+    }
+    
+    // Drops the image now that it can come back, if still over budget
+    enforceLimits();
+    emit changed();
+}
+
+void CaptureHistory::onLoaded(int id, const QImage &image, const QString &error)
+{
+    Record *record = find(id);
+    if (!record) {
+        emit imageFailed(id, "The capture is no longer in the history");
+        return;
+    }
+    
+    record->loading = false;
+    if (image.isNull()) {
+        emit imageFailed(id, error);
+        return;
+    }
+    
+    setImage(record, image);
+    touch(record);
+    ++m_reloads;
+    enforceLimits();
+    emit imageReady(id, image);
+    emit changed();
+}
+
+void CaptureHistory::onThumbnailScaled(int requestId, const QImage &thumbnail)
+{
+    if (Record *record = find(m_thumbnailRequests.take(requestId))) {
+        record->entry.thumbnail = thumbnail;
+        emit changed();
+    }
+}
+
+void CaptureHistory::removeOldest()
+{
+    const Record &oldest = m_records.first();
+    m_residentBytes -= oldest.cost;
+    if (!oldest.spillPath.isEmpty()) {
+        QFile::remove(oldest.spillPath);
+    }
+    m_records.removeFirst();
+}
@@ -0,0 +1,117 @@
+#ifndef CAPTUREHISTORY_H
+#define CAPTUREHISTORY_H
+
+#include <QObject>
+#include <QImage>
+#include <QDateTime>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QScopedPointer>
+
+class QThreadPool;
+class QTemporaryDir;
+class Downscaler;
+
+// Recent captures under a memory budget. Full-resolution images stay in
+// RAM until the budget is exceeded, then the least recently used are
+// dropped: captures with a saved file are reloaded from it, clipboard-only
+// ones are first spilled raw to a temp directory. Thumbnails always stay
+// resident, so the gallery never touches the disk; they are scaled in
+// the background and arrive with a changed(). Spills and reloads run on
+// a background thread too.
+class CaptureHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry
+    {
+        int id = 0;
+        QDateTime taken;
+        QSize size;
+        qreal devicePixelRatio = 1.0;
+        QImage thumbnail;
+        QString filePath;       // Saved file; empty for clipboard-only
+        bool resident = false;  // Full image is in memory
+    };
+
+    explicit CaptureHistory(QObject *parent = nullptr);
+    ~CaptureHistory();
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    // Oldest captures beyond this are forgotten
+    void setMaxEntries(int count);
+
+    // Returns the id of the new entry, which is the most recently used.
+    // image is charged its sizeInBytes(), so it must own its pixels: an
+    // ImageOps::regionView() would keep its whole source alive.
+    int add(const QImage &image, qreal devicePixelRatio);
+    // While a save is in flight the image is never spilled; the saved
+    // file will do once it exists
+    void setSavePending(int id, bool pending);
+    void setSavedPath(int id, const QString &filePath);
+
+    int count() const;
+    bool contains(int id) const;
+    Entry entry(int id) const;
+    // Newest first
+    QVector<Entry> entries() const;
+
+    // The full image if it is in memory, otherwise null. Counts as a use.
+    QImage residentImage(int id);
+    // Answers through imageReady() or imageFailed(): right away (queued)
+    // when resident, otherwise once a background reload finishes
+    void requestImage(int id);
+
+    qint64 residentBytes() const;
+    QString statsText() const;
+
+signals:
+    void changed();
+    void imageReady(int id, const QImage &image);
+    void imageFailed(int id, const QString &error);
+
+private:
+    struct Record
+    {
+        Entry entry;
+        QImage image;
+        qint64 cost = 0;            // Bytes held by image
+        quint64 lastUsed = 0;
+        QString spillPath;
+        bool savePending = false;
+        bool spilling = false;
+        bool spillFailed = false;
+        bool loading = false;
+    };
+
+    Record *find(int id);
+    const Record *find(int id) const;
+    void touch(Record *record);
+    void setImage(Record *record, const QImage &image);
+    void dropImage(Record *record);
+    bool canReload(const Record &record) const;
+    void enforceLimits();
+    void startSpill(Record *record);
+    void onSpilled(int id, const QString &path, bool ok);
+    void onLoaded(int id, const QImage &image, const QString &error);
+    void onThumbnailScaled(int requestId, const QImage &thumbnail);
+    void removeOldest();
+
+    QVector<Record> m_records;      // Oldest first
+    QThreadPool *m_pool;
+    Downscaler *m_downscaler;
+    QHash<int, int> m_thumbnailRequests;   // Downscaler id -> capture id
+    QScopedPointer<QTemporaryDir> m_spillDir;
+    qint64 m_budget;
+    qint64 m_residentBytes;
+    int m_maxEntries;
+    int m_nextId;
+    quint64 m_clock;
+    int m_spills;
+    int m_reloads;
+};
+
+#endif // CAPTUREHISTORY_H
@@ -0,0 +1,44 @@
+#include "capturemimedata.h"
+#include "capturetrace.h"
+#include <QStringList>
+
+namespace {
+
+const char PngMimeType[] = "image/png";
+const char QtImageMimeType[] = "application/x-qt-image";
+
+} // namespace
+
+CaptureMimeData::CaptureMimeData(const SharedEncodedImage &encoded)
+    : m_encoded(encoded)
+{
+}
+
+QStringList CaptureMimeData::formats() const
+{
+    return QStringList() << PngMimeType << QtImageMimeType;
+}
+
+bool CaptureMimeData::hasFormat(const QString &mimeType) const
+{
+    return mimeType == PngMimeType || mimeType == QtImageMimeType;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+QVariant CaptureMimeData::retrieveData(const QString &mimeType, QMetaType type) const
+#else
+QVariant CaptureMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+#endif
+{
+    Q_UNUSED(type);
+    
+    if (mimeType == PngMimeType) {
+        // Waits for the save thread if it is encoding these bytes right now
+        CaptureTrace::Span span("clipboard png");
+        return m_encoded->data();
+    }
+    if (mimeType == QtImageMimeType) {
+        return m_encoded->image();
+    }
+    return QVariant();
+}
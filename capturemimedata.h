@@ -0,0 +1,35 @@
+#ifndef CAPTUREMIMEDATA_H
+#define CAPTUREMIMEDATA_H
+
+#include <QMimeData>
+#include "imageencoder.h"
+
+// Clipboard contents for a capture that produce image data only when a
+// consumer asks for it. image/png is served from the capture's shared
+// PNG encode, which the file save reuses as well, so setting the
+// clipboard costs nothing up front and the pixels are compressed at most
+// once. Other image formats are converted by Qt from the QImage on
+// request.
+class CaptureMimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    // encoded must hold PNG bytes (or produce them on demand)
+    explicit CaptureMimeData(const SharedEncodedImage &encoded);
+
+    QStringList formats() const override;
+    bool hasFormat(const QString &mimeType) const override;
+
+protected:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QVariant retrieveData(const QString &mimeType, QMetaType type) const override;
+#else
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const override;
+#endif
+
+private:
+    SharedEncodedImage m_encoded;
+};
+
+#endif // CAPTUREMIMEDATA_H
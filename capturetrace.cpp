@@ -0,0 +1,264 @@
+#include "capturetrace.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QStringList>
+#include <cstring>
+
+namespace {
+
+const int TraceCapacity = 4096;
+
+struct TraceBuffer
+{
+    QMutex mutex;
+    QElapsedTimer clock;
+    QVector<TraceEvent> events;
+    int next = 0;
+    bool wrapped = false;
+    int currentCapture = 0;
+    quintptr guiThreadId = 0;
+    
+    TraceBuffer()
+    {
+        clock.start();
+        events.resize(TraceCapacity);
+    }
+};
+
+TraceBuffer &traceBuffer()
+{
+    static TraceBuffer buffer;
+    return buffer;
+}
+
+quintptr currentThreadId()
+{
+    return reinterpret_cast<quintptr>(QThread::currentThreadId());
+}
+
+void record(const char *name, int captureId, qint64 startNs, qint64 durationNs)
+{
+    TraceBuffer &buffer = traceBuffer();
+    const quintptr threadId = currentThreadId();
+    
+    QMutexLocker locker(&buffer.mutex);
+    TraceEvent &event = buffer.events[buffer.next];
+    event.name = name;
+    event.captureId = captureId > 0 ? captureId : buffer.currentCapture;
+    event.startNs = startNs;
+    event.durationNs = durationNs;
+    event.threadId = threadId;
+    
+    if (++buffer.next == TraceCapacity) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+const TraceEvent *findEvent(const QVector<TraceEvent> &events, const char *name)
+{
+    for (const TraceEvent &event : events) {
+        if (std::strcmp(event.name, name) == 0) {
+            return &event;
+        }
+    }
+    return nullptr;
+}
+
+QString formatMs(qint64 ns)
+{
+    return QString::number(ns / 1e6, 'f', ns < 10000000 ? 1 : 0);
+}
+
+} // namespace
+
+int CaptureTrace::startCapture()
+{
+    TraceBuffer &buffer = traceBuffer();
+    int id;
+    {
+        QMutexLocker locker(&buffer.mutex);
+        id = ++buffer.currentCapture;
+        buffer.guiThreadId = currentThreadId();
+    }
+    instant("startScreenshot", id);
+    return id;
+}
+
+int CaptureTrace::currentCapture()
+{
+    TraceBuffer &buffer = traceBuffer();
+    QMutexLocker locker(&buffer.mutex);
+    return buffer.currentCapture;
+}
+
+qint64 CaptureTrace::now()
+{
+    return traceBuffer().clock.nsecsElapsed();
+}
+
+void CaptureTrace::instant(const char *name, int captureId)
+{
+    record(name, captureId, now(), -1);
+}
+
+void CaptureTrace::complete(const char *name, qint64 startNs, qint64 endNs, int captureId)
+{
+    record(name, captureId, startNs, endNs - startNs);
+}
+
+CaptureTrace::Span::Span(const char *name, int captureId)
+    : m_name(name)
+    , m_captureId(captureId > 0 ? captureId : CaptureTrace::currentCapture())
+    , m_startNs(CaptureTrace::now())
+{
+}
+
+CaptureTrace::Span::~Span()
+{
+    CaptureTrace::complete(m_name, m_startNs, CaptureTrace::now(), m_captureId);
+}
+
+QVector<TraceEvent> CaptureTrace::events(int captureId)
+{
+    TraceBuffer &buffer = traceBuffer();
+    QMutexLocker locker(&buffer.mutex);
+    
+    QVector<TraceEvent> result;
+    const int count = buffer.wrapped ? TraceCapacity : buffer.next;
+    const int first = buffer.wrapped ? buffer.next : 0;
+    for (int i = 0; i < count; ++i) {
+        const TraceEvent &event = buffer.events.at((first + i) % TraceCapacity);
+        if (captureId == 0 || event.captureId == captureId) {
+            result.append(event);
+        }
+    }
+    return result;
+}
+
+QString CaptureTrace::summary(int captureId)
+{
+    const QVector<TraceEvent> captured = events(captureId);
+    const TraceEvent *start = findEvent(captured, "startScreenshot");
+    const TraceEvent *shown = findEvent(captured, "overlay shown");
+    const TraceEvent *grab = findEvent(captured, "grab");
+    const TraceEvent *selected = findEvent(captured, "selection finished");
+    const TraceEvent *clipboard = findEvent(captured, "clipboard");
+    const TraceEvent *encode = findEvent(captured, "encode");
+    const TraceEvent *encodeReused = findEvent(captured, "encode reused");
+    const TraceEvent *write = findEvent(captured, "write");
+    if (!start || !shown) {
+        return QString();
+    }
+    
+    QString text = QString("Click→overlay %1 ms").arg(formatMs(shown->startNs - start->startNs));
+    if (grab) {
+        text += QString(" (grab %1)").arg(formatMs(grab->durationNs));
+    }
+    if (!selected) {
+        return text;
+    }
+    
+    // The time spent selecting is the user's, not ours
+    QStringList parts;
+    if (clipboard) {
+        parts << "clipboard " + formatMs(clipboard->durationNs);
+    }
+    if (encode) {
+        parts << "encode " + formatMs(encode->durationNs);
+    } else if (encodeReused) {
+        parts << "encode reused";
+    }
+    if (write) {
+        parts << "write " + formatMs(write->durationNs);
+        text += QString(" • selection→file %1 ms")
+                .arg(formatMs(write->startNs + write->durationNs - selected->startNs));
+    } else if (clipboard) {
+        text += QString(" • selection→clipboard %1 ms")
+                .arg(formatMs(clipboard->startNs + clipboard->durationNs - selected->startNs));
+    }
+    if (!parts.isEmpty()) {
+        text += " (" + parts.join(", ") + ")";
+    }
+    return text;
+}
+
+QByteArray CaptureTrace::toChromeJson()
+{
+    const QVector<TraceEvent> all = events();
+    quintptr guiThreadId;
+    {
+        TraceBuffer &buffer = traceBuffer();
+        QMutexLocker locker(&buffer.mutex);
+        guiThreadId = buffer.guiThreadId;
+    }
+    
+    // Chrome wants small thread ids; the GUI thread is always 1
+    QHash<quintptr, int> threadIds;
+    threadIds.insert(guiThreadId, 1);
+    QJsonArray traceEvents;
+    
+    QJsonObject guiName;
+    guiName["name"] = "thread_name";
+    guiName["ph"] = "M";
+    guiName["pid"] = 1;
+    guiName["tid"] = 1;
+    guiName["args"] = QJsonObject{{"name", "GUI thread"}};
+    traceEvents.append(guiName);
+    
+    for (const TraceEvent &event : all) {
+        int tid = threadIds.value(event.threadId);
+        if (tid == 0) {
+            tid = threadIds.size() + 1;
+            threadIds.insert(event.threadId, tid);
+            
+            QJsonObject threadName;
+            threadName["name"] = "thread_name";
+            threadName["ph"] = "M";
+            threadName["pid"] = 1;
+            threadName["tid"] = tid;
+            threadName["args"] = QJsonObject{{"name", QString("Worker %1").arg(tid - 1)}};
+            traceEvents.append(threadName);
+        }
+        
+        QJsonObject object;
+        object["name"] = QString::fromLatin1(event.name);
+        object["cat"] = "capture";
+        object["pid"] = 1;
+        object["tid"] = tid;
+        object["ts"] = event.startNs / 1000.0;
+        if (event.durationNs < 0) {
+            object["ph"] = "i";
+            object["s"] = "t";
+        } else {
+            object["ph"] = "X";
+            object["dur"] = event.durationNs / 1000.0;
+        }
+        object["args"] = QJsonObject{{"capture", event.captureId}};
+        traceEvents.append(object);
+    }
+    
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool CaptureTrace::exportChromeJson(const QString &filePath, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(toChromeJson()) < 0) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef CAPTURETRACE_H
+#define CAPTURETRACE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+struct TraceEvent
+{
+    const char *name;          // String literal; never copied
+    int captureId;
+    qint64 startNs;            // Since the trace clock started
+    qint64 durationNs;         // -1 for an instant
+    quintptr threadId;
+};
+
+// In-process timeline of the capture pipeline. Events go into a fixed
+// ring of the most recent entries, so recording costs a clock read and
+// an uncontended lock, and nothing is allocated after startup. Each
+// capture gets an id; stages recorded on any thread are tagged with it.
+// The buffer can be exported in Chrome's trace event format and opened
+// in chrome://tracing or Perfetto.
+class CaptureTrace
+{
+public:
+    // Start a new capture and make it current. Returns its id.
+    static int startCapture();
+    static int currentCapture();
+
+    static qint64 now();
+
+    // captureId 0 means the current capture
+    static void instant(const char *name, int captureId = 0);
+    static void complete(const char *name, qint64 startNs, qint64 endNs, int captureId = 0);
+
+    // Records a complete event covering its own lifetime
+    class Span
+    {
+    public:
+        explicit Span(const char *name, int captureId = 0);
+        ~Span();
+
+    private:
+        const char *m_name;
+        int m_captureId;
+        qint64 m_startNs;
+    };
+
+    // Events still in the ring, oldest first; captureId 0 returns all
+    static QVector<TraceEvent> events(int captureId = 0);
+
+    // One line of where the time went in a capture, leaving out the time
+    // the user spent selecting. Empty if the capture is no longer traced.
+    static QString summary(int captureId);
+
+    static QByteArray toChromeJson();
+    static bool exportChromeJson(const QString &filePath, QString *error = nullptr);
+};
+
+#endif // CAPTURETRACE_H
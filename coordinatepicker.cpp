@@ -2,134 +2,348 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QMouseEvent>
+#include <QKeyEvent>
 #include <QPainter>
 #include <QClipboard>
 #include <QGuiApplication>
 #include <QMessageBox>
 #include <QScreen>
+#include <QSettings>
+#include <QAction>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QProgressDialog>
+#include <QRegularExpression>
+#include <QTextStream>
+
+namespace {
+
+// Coordinates on one line of an imported file. "(x, y)" pairs are taken
+// as they are, so a pasted Copy All line works; otherwise the last two
+// numbers on the line, which covers "x,y", "Point 3: (x, y)" and CSV
+// rows with an index column first.
+void readCoordinates(const QString &line, QVector<QPoint> *points)
+{
+    static const QRegularExpression pair(R"(\(\s*(-?\d+)\s*,\s*(-?\d+)\s*\))");
+    static const QRegularExpression number(R"(-?\d+)");
+    
+    QRegularExpressionMatchIterator pairs = pair.globalMatch(line);
+    if (pairs.hasNext()) {
+        while (pairs.hasNext()) {
+            const QRegularExpressionMatch match = pairs.next();
+            points->append(QPoint(match.captured(1).toInt(), match.captured(2).toInt()));
+        }
+        return;
+    }
+    
+    int values[2] = {0, 0};
+    int found = 0;
+    QRegularExpressionMatchIterator numbers = number.globalMatch(line);
+    while (numbers.hasNext()) {
+        values[0] = values[1];
+        values[1] = numbers.next().captured(0).toInt();
+        ++found;
+    }
+    if (found >= 2) {
+        points->append(QPoint(values[0], values[1]));
+    }
+}
+
+// One point row of a file PointExporter wrote, already in source pixels
+void readExportedPoint(const QString &line, bool json, QVector<QPoint> *points)
+{
+    static const QRegularExpression jsonPoint(R"("x":(-?\d+),"y":(-?\d+))");
+    
+    if (json) {
+        const QRegularExpressionMatch match = jsonPoint.match(line);
+        if (match.hasMatch()) {
+            points->append(QPoint(match.captured(1).toInt(), match.captured(2).toInt()));
+        }
+        return;
+    }
+    
+    const QStringList fields = line.split(',');
+    bool okX = false;
+    bool okY = false;
+    if (fields.size() >= 3) {
+        const int x = fields.at(1).toInt(&okX);
+        const int y = fields.at(2).toInt(&okY);
+        if (okX && okY) {
+            points->append(QPoint(x, y));
+        }
+    }
+}
+
+} // namespace
 
 // ClickableImageLabel implementation
 ClickableImageLabel::ClickableImageLabel(QWidget *parent)
-    : QLabel(parent)
+    : TiledImageView(parent)
+    , m_store(nullptr)
+    , m_hovering(false)
+    , m_markerZoom(0.0)
+    , m_markersDirty(true)
+    , m_loupeEnabled(false)
 {
-    setMouseTracking(true);
-    setCursor(Qt::CrossCursor);
+    viewport()->setMouseTracking(true);
+    viewport()->setCursor(Qt::CrossCursor);
+    
+    m_markerFont = font();
+    m_markerFont.setBold(true);
+    m_markerFont.setPointSize(9);
 }
 
-void ClickableImageLabel::setPixmap(const QPixmap &pixmap)
+void ClickableImageLabel::setImage(const QImage &image)
 {
-    // Scale to 1920x1080 for consistent coordinate reference
-    // This ensures coordinates are always relative to a standard size
-    QPixmap scaledPixmap = pixmap.scaled(1920, 1080, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-    scaledPixmap.setDevicePixelRatio(1.0);
-    
-    m_originalPixmap = scaledPixmap;
+    TiledImageView::setImage(image);
+    m_loupe.setImage(image);
+}
+
+void ClickableImageLabel::setPointStore(PointStore *store)
+{
+    m_store = store;
+    connect(store, &PointStore::rowsInserted, this, &ClickableImageLabel::onPointsInserted);
+    connect(store, &PointStore::rowsRemoved, this, &ClickableImageLabel::invalidateMarkers);
+    connect(store, &PointStore::modelReset, this, &ClickableImageLabel::invalidateMarkers);
+    invalidateMarkers();
+}
+
+void ClickableImageLabel::onPointsInserted(const QModelIndex &parent, int first, int last)
+{
+    Q_UNUSED(parent);
+    if (first != last || !markerLayerIsCurrent()) {
+        invalidateMarkers();
+        return;
+    }
     
-    QLabel::setPixmap(m_originalPixmap);
-    setFixedSize(m_originalPixmap.size());
+    // A new marker goes on top of the others, so it can be added to the
+    // layer without redrawing it
+    const QPoint centre = markerCentre(m_store->at(first));
+    QPainter painter(&m_markerLayer);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setFont(m_markerFont);
+    drawMarker(painter, first, centre);
+    viewport()->update(markerRect(centre));
 }
 
-void ClickableImageLabel::clearPoints()
+void ClickableImageLabel::invalidateMarkers()
 {
-    m_points.clear();
-    update();
+    // Removals renumber later markers, so the layer is redrawn
+    m_markersDirty = true;
+    viewport()->update();
 }
 
 int ClickableImageLabel::findPointAt(const QPoint &pos) const
 {
-    const int hitRadius = 12; // Click tolerance in pixels
-    for (int i = m_points.size() - 1; i >= 0; --i) {
-        const QPoint &pt = m_points[i];
-        int dx = pos.x() - pt.x();
-        int dy = pos.y() - pt.y();
-        if (dx * dx + dy * dy <= hitRadius * hitRadius) {
-            return i;
-        }
+    const int hitRadius = 12; // Click tolerance in screen pixels
+    if (!m_store) {
+        return -1;
     }
-    return -1;
+    return m_store->findNear(mapToImage(QPointF(pos)), hitRadius / zoom());
+}
+
+QPoint ClickableImageLabel::markerCentre(const QPoint &pixel) const
+{
+    // Centre of the source pixel
+    return mapFromImage(QPointF(pixel) + QPointF(0.5, 0.5)).toPoint();
+}
+
+QRect ClickableImageLabel::markerRect(const QPoint &centre)
+{
+    return QRect(centre.x() - 8, centre.y() - 11, 50, 23);
+}
+
+QRegion ClickableImageLabel::crosshairRegion(const QPoint &pos) const
+{
+    // One pixel either side for antialiasing
+    QRegion region(pos.x() - 1, 0, 3, viewport()->height());
+    region += QRect(0, pos.y() - 1, viewport()->width(), 3);
+    return region;
 }
 
 void ClickableImageLabel::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton) {
-        QPoint pos = event->pos();
-        // Ensure point is within image bounds
-        if (pos.x() >= 0 && pos.x() < m_originalPixmap.width() &&
-            pos.y() >= 0 && pos.y() < m_originalPixmap.height()) {
-            m_points.append(pos);
-            emit pointClicked(pos);
-            update();
+        // Only points inside the image count
+        QPoint pixel;
+        if (m_store && pixelAt(event->pos(), &pixel)) {
+            m_store->append(pixel);
+            emit pointClicked(pixel);
         }
     } else if (event->button() == Qt::RightButton) {
         // Check if clicking on an existing point to delete it
         int index = findPointAt(event->pos());
         if (index >= 0) {
-            m_points.removeAt(index);
-            emit pointRemoved(index);
-            update();
+            m_store->removeAt(index);
         }
+    } else {
+        TiledImageView::mousePressEvent(event);
     }
 }
 
 void ClickableImageLabel::mouseMoveEvent(QMouseEvent *event)
 {
+    TiledImageView::mouseMoveEvent(event);
+    
+    // Repaint only the strips the crosshair leaves and enters
+    QRegion dirty = crosshairRegion(event->pos());
+    if (m_hovering) {
+        dirty += crosshairRegion(m_currentPos);
+    }
     m_currentPos = event->pos();
-    update();
+    m_hovering = true;
+    
+    // And the loupe's old and new rects
+    if (m_loupeEnabled) {
+        QPoint pixel;
+        if (pixelAt(event->pos(), &pixel)) {
+            dirty += m_loupe.moveTo(pixel, event->pos(), viewport()->rect());
+        } else {
+            dirty += m_loupe.hide();
+        }
+    }
+    viewport()->update(dirty);
+}
+
+void ClickableImageLabel::leaveEvent(QEvent *event)
+{
+    TiledImageView::leaveEvent(event);
+    QRegion dirty = m_loupe.hide();
+    if (m_hovering) {
+        m_hovering = false;
+        dirty += crosshairRegion(m_currentPos);
+    }
+    viewport()->update(dirty);
+}
+
+void ClickableImageLabel::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() != Qt::Key_L) {
+        TiledImageView::keyPressEvent(event);
+        return;
+    }
+    
+    m_loupeEnabled = !m_loupeEnabled;
+    QPoint pixel;
+    if (m_loupeEnabled && m_hovering && pixelAt(m_currentPos, &pixel)) {
+        viewport()->update(m_loupe.moveTo(pixel, m_currentPos, viewport()->rect()));
+    } else {
+        viewport()->update(m_loupe.hide());
+    }
+}
+
+void ClickableImageLabel::drawMarker(QPainter &painter, int index, const QPoint &centre) const
+{
+    // Draw point marker
+    painter.setPen(QPen(Qt::white, 2));
+    painter.setBrush(QColor(255, 100, 100));
+    painter.drawEllipse(centre, 6, 6);
+    
+    // Background for number
+    QRect textRect(centre.x() + 10, centre.y() - 10, 30, 20);
+    painter.setBrush(QColor(0, 0, 0, 180));
+    painter.setPen(Qt::NoPen);
+    painter.drawRoundedRect(textRect, 4, 4);
+    
+    // Draw point number
+    painter.setPen(Qt::white);
+    painter.drawText(textRect, Qt::AlignCenter, QString::number(index + 1));
 }
 
-void ClickableImageLabel::paintEvent(QPaintEvent *event)
+bool ClickableImageLabel::markerLayerIsCurrent() const
 {
-    QLabel::paintEvent(event);
+    return !m_markersDirty &&
+           m_markerZoom == zoom() &&
+           m_markerOrigin == mapFromImage(QPointF(0, 0)) &&
+           m_markerLayer.size() == viewport()->size() * viewport()->devicePixelRatioF();
+}
+
+void ClickableImageLabel::rebuildMarkerLayer()
+{
+    const qreal ratio = viewport()->devicePixelRatioF();
+    if (m_markerLayer.size() != viewport()->size() * ratio) {
+        m_markerLayer = QPixmap(viewport()->size() * ratio);
+        m_markerLayer.setDevicePixelRatio(ratio);
+    }
+    m_markerLayer.fill(Qt::transparent);
+    
+    m_markerZoom = zoom();
+    m_markerOrigin = mapFromImage(QPointF(0, 0));
+    m_markersDirty = false;
     
-    QPainter painter(this);
+    QPainter painter(&m_markerLayer);
     painter.setRenderHint(QPainter::Antialiasing);
+    painter.setFont(m_markerFont);
+    
+    if (!m_store) {
+        return;
+    }
+    
+    // Only markers that reach into the view, found through the store's grid
+    const QRect reach = viewport()->rect().adjusted(-42, -12, 8, 11);
+    const QRectF area(mapToImage(QPointF(reach.topLeft())),
+                      mapToImage(QPointF(reach.bottomRight() + QPoint(1, 1))));
+    m_store->forEachIn(area, [&](int row, const QPoint &pixel) {
+        drawMarker(painter, row, markerCentre(pixel));
+    });
+}
+
+void ClickableImageLabel::paintOverlay(QPainter &painter, const QRegion &exposed)
+{
+    if (!markerLayerIsCurrent()) {
+        rebuildMarkerLayer();
+    }
+    
+    // Markers: a straight copy of the exposed parts of the layer
+    for (const QRect &rect : exposed) {
+        painter.drawPixmap(rect, m_markerLayer,
+                           QRectF(QPointF(rect.topLeft()) * m_markerLayer.devicePixelRatio(),
+                                  QSizeF(rect.size()) * m_markerLayer.devicePixelRatio()));
+    }
     
     // Draw crosshair at current mouse position
-    if (rect().contains(m_currentPos)) {
+    if (m_hovering && viewport()->rect().contains(m_currentPos)) {
+        painter.setRenderHint(QPainter::Antialiasing);
         painter.setPen(QPen(QColor(0, 174, 255, 150), 1, Qt::DashLine));
-        painter.drawLine(m_currentPos.x(), 0, m_currentPos.x(), height());
-        painter.drawLine(0, m_currentPos.y(), width(), m_currentPos.y());
+        painter.drawLine(m_currentPos.x(), 0, m_currentPos.x(), viewport()->height());
+        painter.drawLine(0, m_currentPos.y(), viewport()->width(), m_currentPos.y());
     }
     
-    // Draw all clicked points
-    for (int i = 0; i < m_points.size(); ++i) {
-        const QPoint &pt = m_points[i];
-        
-        // Draw point marker
-        painter.setPen(QPen(Qt::white, 2));
-        painter.setBrush(QColor(255, 100, 100));
-        painter.drawEllipse(pt, 6, 6);
-        
-        // Draw point number
-        painter.setPen(Qt::white);
-        QFont font = painter.font();
-        font.setBold(true);
-        font.setPointSize(9);
-        painter.setFont(font);
-        
-        QString numText = QString::number(i + 1);
-        QRect textRect(pt.x() + 10, pt.y() - 10, 30, 20);
-        
-        // Background for number
-        painter.setBrush(QColor(0, 0, 0, 180));
-        painter.setPen(Qt::NoPen);
-        painter.drawRoundedRect(textRect, 4, 4);
-        
-        painter.setPen(Qt::white);
-        painter.drawText(textRect, Qt::AlignCenter, numText);
+    if (m_loupe.isVisible() && exposed.intersects(m_loupe.rect())) {
+        m_loupe.paint(painter);
     }
 }
 
 // CoordinatePicker implementation
-CoordinatePicker::CoordinatePicker(const QPixmap &screenshot, QWidget *parent)
+CoordinatePicker::CoordinatePicker(const QImage &screenshot, qreal devicePixelRatio,
+                                   QWidget *parent)
     : QDialog(parent)
     , m_screenshot(screenshot)
+    , m_store(new PointStore(this))
+    , m_space(ReferenceSpace)
+    , m_exporting(false)
+    , m_exportCancelled(false)
 {
+    m_metadata.sourceSize = m_screenshot.size();
+    m_metadata.devicePixelRatio = devicePixelRatio;
+    m_exportPool.setMaxThreadCount(1);
+    
+    QSettings settings("Cordshot", "Cordshot");
+    if (settings.value("pickerCoordinates").toString() == "source") {
+        m_space = SourcePixels;
+    }
+    m_store->setDisplayMapping([this](const QPoint &pixel) {
+        return displayPoint(pixel);
+    });
     setupUI();
 }
 
 CoordinatePicker::~CoordinatePicker()
 {
+    // The worker posts back to this dialog; let it finish first
+    m_exportCancelled = true;
+    m_exportPool.waitForDone();
 }
 
 void CoordinatePicker::setupUI()
@@ -144,8 +358,12 @@ void CoordinatePicker::setupUI()
     mainLayout->setContentsMargins(10, 10, 10, 10);
     mainLayout->setSpacing(10);
     
-    // Instruction label
-    m_instructionLabel = new QLabel("Left-click to add points • Right-click on a point to delete it", this);
+    // Instruction label and view controls
+    QHBoxLayout *topLayout = new QHBoxLayout();
+    topLayout->setSpacing(10);
+    
+    m_instructionLabel = new QLabel("Left-click to add points • Right-click on a point to delete it • "
+                                    "Scroll to zoom, middle-drag to pan, 0 to fit, 1 for 100%, L for magnifier", this);
     m_instructionLabel->setStyleSheet(R"(
         QLabel {
             color: #E0E0E0;
@@ -155,39 +373,100 @@ void CoordinatePicker::setupUI()
             border-radius: 6px;
         }
     )");
-    mainLayout->addWidget(m_instructionLabel);
-    
-    // Scroll area for the image
-    m_scrollArea = new QScrollArea(this);
-    m_scrollArea->setWidgetResizable(false);
-    m_scrollArea->setAlignment(Qt::AlignCenter);
-    m_scrollArea->setStyleSheet(R"(
-        QScrollArea {
+    topLayout->addWidget(m_instructionLabel, 1);
+    
+    m_zoomLabel = new QLabel(this);
+    m_zoomLabel->setMinimumWidth(56);
+    m_zoomLabel->setAlignment(Qt::AlignCenter);
+    m_zoomLabel->setStyleSheet(m_instructionLabel->styleSheet());
+    topLayout->addWidget(m_zoomLabel);
+    
+    // Coordinates as source pixels, or scaled to the 1920×1080 reference
+    m_spaceCombo = new QComboBox(this);
+    m_spaceCombo->addItem("1920×1080 reference", ReferenceSpace);
+    m_spaceCombo->addItem("Source pixels", SourcePixels);
+    m_spaceCombo->setCurrentIndex(m_spaceCombo->findData(m_space));
+    m_spaceCombo->setCursor(Qt::PointingHandCursor);
+    m_spaceCombo->setStyleSheet(R"(
+        QComboBox {
+            background-color: #2A2A3C;
+            color: #E0E0E0;
+            border: 1px solid #3A3A4C;
+            border-radius: 6px;
+            font-size: 12px;
+            padding: 6px 10px;
+        }
+        QComboBox QAbstractItemView {
+            background-color: #2A2A3C;
+            color: #E0E0E0;
+            selection-background-color: #4A4A5C;
+        }
+    )");
+    connect(m_spaceCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &CoordinatePicker::onCoordinateSpaceChanged);
+    topLayout->addWidget(m_spaceCombo);
+    
+    mainLayout->addLayout(topLayout);
+    
+    // The image view scrolls and zooms itself
+    m_imageLabel = new ClickableImageLabel(this);
+    m_imageLabel->setStyleSheet(R"(
+        QAbstractScrollArea {
             background-color: #1A1A2A;
             border: 2px solid #3A3A4C;
             border-radius: 8px;
         }
     )");
-    
-    m_imageLabel = new ClickableImageLabel();
-    m_imageLabel->setPixmap(m_screenshot);
     connect(m_imageLabel, &ClickableImageLabel::pointClicked, this, &CoordinatePicker::onPointClicked);
-    connect(m_imageLabel, &ClickableImageLabel::pointRemoved, this, &CoordinatePicker::onPointRemoved);
+    connect(m_imageLabel, &TiledImageView::zoomChanged, this, &CoordinatePicker::onZoomChanged);
+    m_imageLabel->setImage(m_screenshot);
+    m_imageLabel->setPointStore(m_store);
+    mainLayout->addWidget(m_imageLabel, 1);
+    
+    // Point list; only the visible rows are ever built, whatever the count
+    m_pointList = new QListView(this);
+    m_pointList->setModel(m_store);
+    m_pointList->setUniformItemSizes(true);
+    m_pointList->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_pointList->setFixedHeight(120);
+    m_pointList->setStyleSheet(R"(
+        QListView {
+            color: #4ADE80;
+            font-size: 13px;
+            font-family: Consolas, monospace;
+            padding: 6px;
+            background-color: #1E1E2E;
+            border: 1px solid #3A3A4C;
+            border-radius: 6px;
+        }
+        QListView::item:selected {
+            background-color: #3A3A4C;
+            color: #FFFFFF;
+        }
+    )");
+    connect(m_pointList->selectionModel(), &QItemSelectionModel::selectionChanged,
+            this, &CoordinatePicker::onPointsChanged);
+    
+    QAction *deleteAction = new QAction(m_pointList);
+    deleteAction->setShortcut(QKeySequence::Delete);
+    deleteAction->setShortcutContext(Qt::WidgetShortcut);
+    connect(deleteAction, &QAction::triggered, this, &CoordinatePicker::deleteSelectedPoints);
+    m_pointList->addAction(deleteAction);
+    mainLayout->addWidget(m_pointList);
     
-    m_scrollArea->setWidget(m_imageLabel);
-    mainLayout->addWidget(m_scrollArea, 1);
+    connect(m_store, &PointStore::rowsInserted, this, &CoordinatePicker::onPointsChanged);
+    connect(m_store, &PointStore::rowsRemoved, this, &CoordinatePicker::onPointsChanged);
+    connect(m_store, &PointStore::modelReset, this, &CoordinatePicker::onPointsChanged);
     
-    // Coordinate display
+    // Status line: point count and what was copied last
     m_coordLabel = new QLabel("No points selected", this);
-    m_coordLabel->setMinimumHeight(60);
-    m_coordLabel->setWordWrap(true);
     m_coordLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
     m_coordLabel->setStyleSheet(R"(
         QLabel {
             color: #4ADE80;
             font-size: 13px;
             font-family: Consolas, monospace;
-            padding: 10px;
+            padding: 8px 10px;
             background-color: #1E1E2E;
             border: 1px solid #3A3A4C;
             border-radius: 6px;
@@ -239,6 +518,26 @@ void CoordinatePicker::setupUI()
     connect(m_clearButton, &QPushButton::clicked, this, &CoordinatePicker::clearPoints);
     buttonLayout->addWidget(m_clearButton);
     
+    m_deleteButton = new QPushButton("Delete Selected", this);
+    m_deleteButton->setEnabled(false);
+    m_deleteButton->setCursor(Qt::PointingHandCursor);
+    m_deleteButton->setStyleSheet(m_copyLastButton->styleSheet());
+    connect(m_deleteButton, &QPushButton::clicked, this, &CoordinatePicker::deleteSelectedPoints);
+    buttonLayout->addWidget(m_deleteButton);
+    
+    m_importButton = new QPushButton("📂 Import...", this);
+    m_importButton->setCursor(Qt::PointingHandCursor);
+    m_importButton->setStyleSheet(m_copyLastButton->styleSheet());
+    connect(m_importButton, &QPushButton::clicked, this, &CoordinatePicker::importPoints);
+    buttonLayout->addWidget(m_importButton);
+    
+    m_exportButton = new QPushButton("💾 Export...", this);
+    m_exportButton->setEnabled(false);
+    m_exportButton->setCursor(Qt::PointingHandCursor);
+    m_exportButton->setStyleSheet(m_copyLastButton->styleSheet());
+    connect(m_exportButton, &QPushButton::clicked, this, &CoordinatePicker::exportPoints);
+    buttonLayout->addWidget(m_exportButton);
+    
     buttonLayout->addStretch();
     
     m_closeButton = new QPushButton("Close", this);
@@ -284,96 +583,257 @@ void CoordinatePicker::setupUI()
     int maxHeight = screenGeometry.height() - 100;
     
     // Dialog size: image + UI elements, but capped to screen size
-    int dialogWidth = qMin(1920 + 40, maxWidth);
-    int dialogHeight = qMin(1080 + 180, maxHeight);
+    int dialogWidth = qMin(m_screenshot.width() + 40, maxWidth);
+    int dialogHeight = qMin(m_screenshot.height() + 180, maxHeight);
+    dialogWidth = qMax(dialogWidth, 600);
+    dialogHeight = qMax(dialogHeight, 500);
     
     resize(dialogWidth, dialogHeight);
 }
 
 void CoordinatePicker::onPointClicked(const QPoint &point)
 {
-    m_points.append(point);
-    updateCoordinateDisplay();
-    
     // Auto-copy to clipboard
-    QString coord = QString("(%1, %2)").arg(point.x()).arg(point.y());
+    const QPoint shown = displayPoint(point);
+    QString coord = QString("(%1, %2)").arg(shown.x()).arg(shown.y());
     QGuiApplication::clipboard()->setText(coord);
     
-    m_copyLastButton->setEnabled(true);
-    m_copyAllButton->setEnabled(true);
-    m_clearButton->setEnabled(true);
+    m_lastCopied = "✓ Copied: " + coord;
+    updateCoordinateDisplay();
+    m_pointList->scrollToBottom();
 }
 
-void CoordinatePicker::onPointRemoved(int index)
+void CoordinatePicker::onPointsChanged()
 {
-    if (index >= 0 && index < m_points.size()) {
-        m_points.removeAt(index);
-    }
-    
-    updateCoordinateDisplay();
-    
-    bool hasPoints = !m_points.isEmpty();
+    bool hasPoints = m_store->count() > 0;
     m_copyLastButton->setEnabled(hasPoints);
     m_copyAllButton->setEnabled(hasPoints);
     m_clearButton->setEnabled(hasPoints);
+    m_exportButton->setEnabled(hasPoints && !m_exporting);
+    m_deleteButton->setEnabled(m_pointList->selectionModel()->hasSelection());
     
-    if (!hasPoints) {
-        m_coordLabel->setText("No points selected");
-    }
+    updateCoordinateDisplay();
 }
 
 void CoordinatePicker::updateCoordinateDisplay()
 {
-    if (m_points.isEmpty()) {
+    // Constant work per update; the list shows the points themselves
+    const int count = m_store->count();
+    if (count == 0) {
         m_coordLabel->setText("No points selected");
         return;
     }
     
-    QStringList lines;
-    for (int i = 0; i < m_points.size(); ++i) {
-        const QPoint &pt = m_points[i];
-        lines << QString("Point %1: (%2, %3)").arg(i + 1).arg(pt.x()).arg(pt.y());
+    QString text = QString("%1 point%2").arg(count).arg(count == 1 ? "" : "s");
+    if (!m_lastCopied.isEmpty()) {
+        text += "  •  " + m_lastCopied;
     }
-    
-    QString lastCoord = QString("(%1, %2)").arg(m_points.last().x()).arg(m_points.last().y());
-    m_coordLabel->setText(lines.join("  |  ") + "\n\n✓ Copied: " + lastCoord);
+    m_coordLabel->setText(text);
 }
 
 void CoordinatePicker::copyLastCoordinate()
 {
-    if (m_points.isEmpty()) return;
+    if (m_store->count() == 0) return;
     
-    const QPoint &pt = m_points.last();
+    const QPoint pt = displayPoint(m_store->at(m_store->count() - 1));
     QString coord = QString("(%1, %2)").arg(pt.x()).arg(pt.y());
     QGuiApplication::clipboard()->setText(coord);
     
-    m_coordLabel->setText(m_coordLabel->text().split("\n\n").first() + "\n\n✓ Copied: " + coord);
+    m_lastCopied = "✓ Copied: " + coord;
+    updateCoordinateDisplay();
 }
 
 void CoordinatePicker::copyAllCoordinates()
 {
-    if (m_points.isEmpty()) return;
-    
-    QStringList coords;
-    for (const QPoint &pt : m_points) {
-        coords << QString("(%1, %2)").arg(pt.x()).arg(pt.y());
+    if (m_store->count() == 0) return;
+    
+    const QVector<QPoint> points = m_store->points();
+    QString allCoords;
+    allCoords.reserve(points.size() * 14);
+    for (const QPoint &point : points) {
+        const QPoint pt = displayPoint(point);
+        if (!allCoords.isEmpty()) {
+            allCoords += ", ";
+        }
+        allCoords += QString("(%1, %2)").arg(pt.x()).arg(pt.y());
     }
-    
-    QString allCoords = coords.join(", ");
     QGuiApplication::clipboard()->setText(allCoords);
     
-    m_coordLabel->setText(m_coordLabel->text().split("\n\n").first() + "\n\n✓ Copied all: " + allCoords);
+    m_lastCopied = QString("✓ Copied all %1").arg(points.size());
+    updateCoordinateDisplay();
 }
 
 void CoordinatePicker::clearPoints()
 {
-    m_points.clear();
-    m_imageLabel->clearPoints();
+    m_store->clear();
+    m_lastCopied.clear();
     updateCoordinateDisplay();
+}
+
+void CoordinatePicker::deleteSelectedPoints()
+{
+    const QModelIndexList selected = m_pointList->selectionModel()->selectedRows();
+    if (selected.isEmpty()) {
+        return;
+    }
     
-    m_copyLastButton->setEnabled(false);
-    m_copyAllButton->setEnabled(false);
-    m_clearButton->setEnabled(false);
+    QVector<int> rows;
+    rows.reserve(selected.size());
+    for (const QModelIndex &index : selected) {
+        rows.append(index.row());
+    }
+    m_store->remove(rows);
+}
+
+void CoordinatePicker::importPoints()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Import Points", QString(),
+        "Coordinate lists (*.txt *.csv *.jsonl);;All Files (*)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, "Import Failed",
+            QString("Could not open %1:\n%2").arg(fileName, file.errorString()));
+        return;
+    }
+    
+    // Files from Export carry source pixels in known fields; anything
+    // else is read in the space the picker is showing
+    QVector<QPoint> points;
+    QTextStream in(&file);
+    QString line;
+    in.readLineInto(&line);
+    const bool exportedCsv = line.startsWith("index,x,y,");
+    const bool exportedJson = line.startsWith(R"({"type":"capture")");
+    if (exportedCsv || exportedJson) {
+        while (in.readLineInto(&line)) {
+            readExportedPoint(line, exportedJson, &points);
+        }
+    } else {
+        do {
+            readCoordinates(line, &points);
+        } while (in.readLineInto(&line));
+        for (QPoint &point : points) {
+            point = sourcePoint(point);
+        }
+    }
+    
+    if (points.isEmpty()) {
+        QMessageBox::information(this, "Import Points",
+            "No coordinates were found in that file.");
+        return;
+    }
+    
+    // A file made for another capture can point anywhere; only pixels of
+    // this image get a marker, an export row and a grid cell
+    const QRect bounds = m_screenshot.rect();
+    QVector<QPoint> inside;
+    inside.reserve(points.size());
+    for (const QPoint &point : points) {
+        if (bounds.contains(point)) {
+            inside.append(point);
+        }
+    }
+    const int skipped = points.size() - inside.size();
+    if (inside.isEmpty()) {
+        QMessageBox::information(this, "Import Points",
+            QString("None of the %1 coordinates in that file lie inside this image.")
+                .arg(points.size()));
+        return;
+    }
+    m_store->append(inside);
+    m_lastCopied = skipped > 0
+        ? QString("Imported %1, skipped %2 outside the image").arg(inside.size()).arg(skipped)
+        : QString("Imported %1").arg(inside.size());
+    updateCoordinateDisplay();
+}
+
+void CoordinatePicker::exportPoints()
+{
+    if (m_store->count() == 0 || m_exporting) {
+        return;
+    }
+    
+    QString selectedFilter;
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Points", "points.csv",
+        PointExporter::fileDialogFilter(), &selectedFilter);
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (QFileInfo(fileName).suffix().isEmpty()) {
+        fileName += selectedFilter.startsWith("JSON") ? ".jsonl"
+                  : selectedFilter.startsWith("Binary") ? ".bin" : ".csv";
+    }
+    
+    // The worker gets its own copy; picking can carry on meanwhile
+    const QVector<QPoint> points = m_store->points();
+    const PointExportMetadata metadata = m_metadata;
+    const PointExporter::Format format = PointExporter::formatForPath(fileName);
+    
+    // Only appears if the export is still running after 300 ms
+    QProgressDialog *progress = new QProgressDialog(
+        QString("Exporting %1 points...").arg(points.size()), "Cancel", 0, points.size(), this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    connect(progress, &QProgressDialog::canceled, this, [this]() {
+        m_exportCancelled = true;
+    });
+    
+    m_exporting = true;
+    m_exportCancelled = false;
+    m_exportButton->setEnabled(false);
+    m_exportPool.start([this, points, metadata, fileName, format, progress]() {
+        QString error;
+        const bool ok = PointExporter::write(points, metadata, fileName, format,
+            [this, progress](int done, int) {
+                QMetaObject::invokeMethod(this, [progress, done]() {
+                    progress->setValue(done);
+                }, Qt::QueuedConnection);
+                return !m_exportCancelled;
+            }, &error);
+        
+        const int count = points.size();
+        QMetaObject::invokeMethod(this, [this, ok, error, fileName, count, progress]() {
+            progress->deleteLater();
+            m_exporting = false;
+            if (ok) {
+                m_lastCopied = QString("✓ Exported %1 to %2")
+                    .arg(count).arg(QFileInfo(fileName).fileName());
+            } else if (!m_exportCancelled) {
+                QMessageBox::warning(this, "Export Failed",
+                    QString("Could not write %1:\n%2").arg(fileName, error));
+            }
+            onPointsChanged();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CoordinatePicker::onCoordinateSpaceChanged(int index)
+{
+    m_space = static_cast<CoordinateSpace>(m_spaceCombo->itemData(index).toInt());
+    
+    QSettings settings("Cordshot", "Cordshot");
+    settings.setValue("pickerCoordinates", m_space == SourcePixels ? "source" : "reference");
     
-    m_coordLabel->setText("No points selected");
+    m_store->refreshDisplay();
+}
+
+void CoordinatePicker::onZoomChanged(qreal zoom)
+{
+    m_zoomLabel->setText(QString("%1%").arg(qRound(zoom * 100)));
+}
+
+QPoint CoordinatePicker::displayPoint(const QPoint &pixel) const
+{
+    return m_space == SourcePixels ? pixel : m_metadata.toReference(pixel);
+}
+
+QPoint CoordinatePicker::sourcePoint(const QPoint &shown) const
+{
+    return m_space == SourcePixels ? shown : m_metadata.fromReference(shown);
 }
@@ -1,38 +1,70 @@
 #ifndef COORDINATEPICKER_H
 #define COORDINATEPICKER_H
 
+#include "tiledimageview.h"
+#include "pointstore.h"
+#include "pixelloupe.h"
+#include "pointexporter.h"
 #include <QDialog>
 #include <QLabel>
 #include <QPushButton>
-#include <QScrollArea>
-#include <QPixmap>
+#include <QComboBox>
+#include <QListView>
+#include <QImage>
 #include <QPoint>
-#include <QVector>
+#include <QFont>
+#include <QThreadPool>
+#include <atomic>
 
-class ClickableImageLabel : public QLabel
+// Picker view: tiled, zoomable image with a crosshair and numbered
+// markers. Clicks add to and remove from the point store it shows.
+class ClickableImageLabel : public TiledImageView
 {
     Q_OBJECT
 
 public:
     explicit ClickableImageLabel(QWidget *parent = nullptr);
-    void setPixmap(const QPixmap &pixmap);
-    void clearPoints();
+    void setImage(const QImage &image) override;
+    void setPointStore(PointStore *store);
 
 signals:
     void pointClicked(const QPoint &point);
-    void pointRemoved(int index);
 
 protected:
+    void paintOverlay(QPainter &painter, const QRegion &exposed) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
-    void paintEvent(QPaintEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
 
 private:
+    void onPointsInserted(const QModelIndex &parent, int first, int last);
+    void invalidateMarkers();
     int findPointAt(const QPoint &pos) const;
+    QPoint markerCentre(const QPoint &pixel) const;
+    // Everything a marker draws, number badge included
+    static QRect markerRect(const QPoint &centre);
+    // Strips under the crosshair lines through pos
+    QRegion crosshairRegion(const QPoint &pos) const;
+    void drawMarker(QPainter &painter, int index, const QPoint &centre) const;
+    bool markerLayerIsCurrent() const;
+    void rebuildMarkerLayer();
     
-    QPixmap m_originalPixmap;
-    QVector<QPoint> m_points;
+    PointStore *m_store;
     QPoint m_currentPos;
+    bool m_hovering;
+    
+    // Markers are drawn once into this layer, which is only redrawn when
+    // points are removed or the view zooms, scrolls or resizes
+    QPixmap m_markerLayer;
+    QPointF m_markerOrigin;
+    qreal m_markerZoom;
+    bool m_markersDirty;
+    QFont m_markerFont;
+    
+    // Magnifier toggled with L
+    PixelLoupe m_loupe;
+    bool m_loupeEnabled;
 };
 
 class CoordinatePicker : public QDialog
@@ -40,30 +72,56 @@ class CoordinatePicker : public QDialog
     Q_OBJECT
 
 public:
-    explicit CoordinatePicker(const QPixmap &screenshot, QWidget *parent = nullptr);
+    explicit CoordinatePicker(const QImage &screenshot, qreal devicePixelRatio = 1.0,
+                              QWidget *parent = nullptr);
     ~CoordinatePicker();
 
 private slots:
     void onPointClicked(const QPoint &point);
-    void onPointRemoved(int index);
+    void onPointsChanged();
     void copyLastCoordinate();
     void copyAllCoordinates();
     void clearPoints();
+    void importPoints();
+    void exportPoints();
+    void deleteSelectedPoints();
+    void onCoordinateSpaceChanged(int index);
+    void onZoomChanged(qreal zoom);
 
 private:
+    enum CoordinateSpace {
+        SourcePixels,       // Pixels of the capture itself
+        ReferenceSpace      // Scaled to 1920×1080, as before tiled viewing
+    };
+
     void setupUI();
     void updateCoordinateDisplay();
+    // A picked source pixel in the coordinate space shown to the user
+    QPoint displayPoint(const QPoint &pixel) const;
+    // Inverse of displayPoint, for imported coordinates
+    QPoint sourcePoint(const QPoint &shown) const;
 
-    QPixmap m_screenshot;
+    QImage m_screenshot;
+    PointExportMetadata m_metadata;
     ClickableImageLabel *m_imageLabel;
-    QScrollArea *m_scrollArea;
+    QComboBox *m_spaceCombo;
+    QLabel *m_zoomLabel;
+    PointStore *m_store;
+    QListView *m_pointList;
     QLabel *m_coordLabel;
     QLabel *m_instructionLabel;
     QPushButton *m_copyLastButton;
     QPushButton *m_copyAllButton;
     QPushButton *m_clearButton;
+    QPushButton *m_importButton;
+    QPushButton *m_exportButton;
+    QPushButton *m_deleteButton;
     QPushButton *m_closeButton;
-    QVector<QPoint> m_points;
+    QString m_lastCopied;
+    CoordinateSpace m_space;
+    QThreadPool m_exportPool;       // One export at a time, off the GUI thread
+    bool m_exporting;
+    std::atomic<bool> m_exportCancelled;
 };
 
 #endif // COORDINATEPICKER_H
@@ -0,0 +1,31 @@
+#include "downscaler.h"
+#include "imageops.h"
+#include <QThreadPool>
+
+Downscaler::Downscaler(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_nextId(1)
+{
+    // The kernels split each image into stripes on the global pool
+    // themselves; a job here waiting on its stripes must not hold a
+    // thread they need
+    m_pool->setMaxThreadCount(1);
+}
+
+Downscaler::~Downscaler()
+{
+    m_pool->waitForDone();
+}
+
+int Downscaler::request(const QImage &image, const QSize &bounds)
+{
+    const int id = m_nextId++;
+    m_pool->start([this, id, image, bounds]() {
+        const QImage result = ImageOps::downscaled(image, bounds);
+        QMetaObject::invokeMethod(this, [this, id, result]() {
+            emit scaled(id, result);
+        }, Qt::QueuedConnection);
+    });
+    return id;
+}
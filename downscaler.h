@@ -0,0 +1,34 @@
+#ifndef DOWNSCALER_H
+#define DOWNSCALER_H
+
+#include <QObject>
+#include <QImage>
+#include <QSize>
+
+class QThreadPool;
+
+// Scaled-down copies of captures for previews and thumbnails, made on a
+// background thread with ImageOps::downscaled() so the GUI thread never
+// touches the full-resolution pixels. Results arrive through scaled() in
+// request order.
+class Downscaler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Downscaler(QObject *parent = nullptr);
+    ~Downscaler();
+
+    // Fit image inside bounds, keeping its aspect ratio. The image is
+    // shared with the worker, not copied. Returns an id for scaled().
+    int request(const QImage &image, const QSize &bounds);
+
+signals:
+    void scaled(int id, const QImage &result);
+
+private:
+    QThreadPool *m_pool;
+    int m_nextId;
+};
+
+#endif // DOWNSCALER_H
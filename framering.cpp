@@ -0,0 +1,74 @@
+#include "framering.h"
+#include <QMutexLocker>
+
+FrameRing::FrameRing(int capacity, qint64 maxBytes)
+    : m_slots(qMax(1, capacity))
+    , m_head(0)
+    , m_count(0)
+    , m_highWater(0)
+    , m_bytes(0)
+    , m_maxBytes(maxBytes)
+    , m_closed(false)
+{
+}
+
+bool FrameRing::tryPush(TimedFrame frame)
+{
+    const qint64 frameBytes = frame.image.sizeInBytes();
+    
+    QMutexLocker locker(&m_mutex);
+    if (m_closed || m_count == m_slots.size()) {
+        return false;
+    }
+    // A single frame larger than the budget is still accepted into an
+    // empty ring, otherwise nothing could ever be captured
+    if (m_count > 0 && m_bytes + frameBytes > m_maxBytes) {
+        return false;
+    }
+    
+    const int tail = (m_head + m_count) % m_slots.size();
+    m_slots[tail] = std::move(frame);
+    ++m_count;
+    m_bytes += frameBytes;
+    m_highWater = qMax(m_highWater, m_count);
+    
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+bool FrameRing::pop(TimedFrame *frame)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_count == 0) {
+        if (m_closed) {
+            return false;
+        }
+        m_notEmpty.wait(&m_mutex);
+    }
+    
+    *frame = std::move(m_slots[m_head]);
+    m_slots[m_head] = TimedFrame();
+    m_head = (m_head + 1) % m_slots.size();
+    --m_count;
+    m_bytes -= frame->image.sizeInBytes();
+    return true;
+}
+
+void FrameRing::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_closed = true;
+    m_notEmpty.wakeAll();
+}
+
+int FrameRing::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_count;
+}
+
+int FrameRing::highWater() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_highWater;
+}
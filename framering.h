@@ -0,0 +1,52 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QImage>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+struct TimedFrame
+{
+    QImage image;
+    quint64 sequence;
+    qint64 timestampNs;   // Monotonic, since the start of the session
+    qint64 wallClockMs;   // Milliseconds since the epoch
+
+    TimedFrame() : sequence(0), timestampNs(0), wallClockMs(0) {}
+};
+
+// Fixed-size ring of captured frames shared between the capture thread
+// and the encoder threads. It never grows: when it is full (by frame count
+// or by bytes) tryPush() refuses the frame and the caller counts a drop,
+// which is the backpressure that keeps memory bounded.
+class FrameRing
+{
+public:
+    FrameRing(int capacity, qint64 maxBytes);
+
+    bool tryPush(TimedFrame frame);
+
+    // Blocks until a frame is available or the ring is closed and empty.
+    // Returns false in the latter case.
+    bool pop(TimedFrame *frame);
+
+    // Wake all waiting consumers; frames already queued are still handed out
+    void close();
+
+    int size() const;
+    int highWater() const;
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QVector<TimedFrame> m_slots;
+    int m_head;
+    int m_count;
+    int m_highWater;
+    qint64 m_bytes;
+    qint64 m_maxBytes;
+    bool m_closed;
+};
+
+#endif // FRAMERING_H
@@ -0,0 +1,430 @@
+#include "framespool.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <cstring>
+
+namespace {
+
+const char SpoolMagic[4] = {'C', 'S', 'P', 'L'};
+const quint32 SpoolVersion = 1;
+
+// File header and metadata; records start after it
+const qint64 HeaderSize = 4096;
+
+const quint32 RecordMagic = 0x454D5246;    // "FRME"
+const quint32 WrapMagic = 0x50415257;      // "WRAP": continue at the first record
+
+enum RecordState : quint32 {
+    Writing = 1,
+    Committed = 2,
+    Released = 3
+};
+
+struct SpoolHeader
+{
+    char magic[4];
+    quint32 version;
+    quint64 capacity;
+    quint64 headOffset;        // Oldest record not yet released
+    quint32 metadataBytes;     // JSON, straight after this header
+    quint32 reserved;
+};
+
+struct RecordHeader
+{
+    quint32 magic;
+    quint32 state;
+    quint64 sequence;
+    qint64 timestampNs;
+    qint64 wallClockMs;
+    qint32 x;
+    qint32 y;
+    qint32 width;
+    qint32 height;
+    qint32 stride;
+    quint32 format;
+    quint64 bytes;             // Whole record, this header included
+};
+
+static_assert(sizeof(RecordHeader) == 64, "records are 64-byte aligned");
+
+inline qint64 alignRecord(qint64 bytes)
+{
+    return (bytes + 63) & ~qint64(63);
+}
+
+} // namespace
+
+FrameSpool::FrameSpool()
+    : m_map(nullptr)
+    , m_capacity(0)
+    , m_tail(HeaderSize)
+    , m_nextToRead(0)
+    , m_highWater(0)
+    , m_recovered(0)
+    , m_closed(false)
+{
+}
+
+FrameSpool::~FrameSpool()
+{
+    bool finished;
+    {
+        QMutexLocker locker(&m_mutex);
+        finished = m_closed && m_slots.isEmpty();
+    }
+    
+    if (m_map) {
+        m_file.unmap(m_map);
+    }
+    m_file.close();
+    
+    // Anything left over stays on disk for the next run to recover
+    if (finished && m_lock) {
+        m_file.remove();
+    }
+}
+
+bool FrameSpool::create(const QString &path, qint64 capacity, const Metadata &metadata,
+                        QString *error)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    if (!lock(path, error)) {
+        return false;
+    }
+    
+    QJsonObject json;
+    json["outputDir"] = metadata.outputDir;
+    json["format"] = QString::fromLatin1(metadata.format);
+    json["preset"] = metadata.presetKey;
+    json["framesPerFolder"] = metadata.framesPerFolder;
+    const QByteArray metadataBytes = QJsonDocument(json).toJson(QJsonDocument::Compact);
+    if (qint64(sizeof(SpoolHeader)) + metadataBytes.size() > HeaderSize) {
+        if (error) {
+            *error = "Output folder path is too long for the frame spool";
+        }
+        return false;
+    }
+    
+    m_file.setFileName(path);
+    m_capacity = HeaderSize + alignRecord(qMax<qint64>(capacity, 64));
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !m_file.resize(m_capacity)) {
+        if (error) {
+            *error = QString("Cannot create frame spool %1: %2").arg(path, m_file.errorString());
+        }
+        return false;
+    }
+    if (!map(error)) {
+        return false;
+    }
+    
+    SpoolHeader *header = reinterpret_cast<SpoolHeader *>(m_map);
+    std::memcpy(header->magic, SpoolMagic, 4);
+    header->version = SpoolVersion;
+    header->capacity = quint64(m_capacity);
+    header->headOffset = quint64(HeaderSize);
+    header->metadataBytes = quint32(metadataBytes.size());
+    std::memcpy(m_map + sizeof(SpoolHeader), metadataBytes.constData(), metadataBytes.size());
+    
+    m_metadata = metadata;
+    m_tail = HeaderSize;
+    return true;
+}
+
+bool FrameSpool::recover(const QString &path, QString *error)
+{
+    if (!lock(path, error)) {
+        return false;
+    }
+    
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite) || m_file.size() < HeaderSize) {
+        if (error) {
+            *error = QString("Cannot open frame spool %1").arg(path);
+        }
+        return false;
+    }
+    m_capacity = m_file.size();
+    if (!map(error)) {
+        return false;
+    }
+    
+    const SpoolHeader *header = reinterpret_cast<const SpoolHeader *>(m_map);
+    if (std::memcmp(header->magic, SpoolMagic, 4) != 0 || header->version != SpoolVersion
+        || qint64(header->capacity) != m_capacity
+        || qint64(sizeof(SpoolHeader)) + header->metadataBytes > HeaderSize) {
+        if (error) {
+            *error = QString("%1 is not a frame spool").arg(path);
+        }
+        return false;
+    }
+    
+    const QJsonObject json = QJsonDocument::fromJson(QByteArray(
+        reinterpret_cast<const char *>(m_map + sizeof(SpoolHeader)),
+        int(header->metadataBytes))).object();
+    m_metadata.outputDir = json["outputDir"].toString();
+    m_metadata.format = json["format"].toString().toLatin1();
+    m_metadata.presetKey = json["preset"].toString();
+    m_metadata.framesPerFolder = json["framesPerFolder"].toInt();
+    
+    // Follow the chain from the oldest unreleased frame. Sequences only
+    // grow, so a stale record from an earlier lap, or a frame that was
+    // still being written, ends it.
+    qint64 offset = qBound(HeaderSize, qint64(header->headOffset), m_capacity);
+    quint64 lastSequence = 0;
+    qint64 walked = 0;
+    while (walked < m_capacity - HeaderSize) {
+        if (offset >= m_capacity) {
+            offset = HeaderSize;
+        }
+        const RecordHeader *record = reinterpret_cast<const RecordHeader *>(m_map + offset);
+        if (record->magic == WrapMagic) {
+            walked += m_capacity - offset;
+            offset = HeaderSize;
+            continue;
+        }
+        if (record->magic != RecordMagic || record->sequence <= lastSequence
+            || record->bytes < sizeof(RecordHeader) || offset + qint64(record->bytes) > m_capacity
+            || (record->state != Committed && record->state != Released)) {
+            break;
+        }
+        
+        lastSequence = record->sequence;
+        if (record->state == Committed) {
+            m_slots.append({offset, false});
+        }
+        walked += qint64(record->bytes);
+        offset += qint64(record->bytes);
+    }
+    
+    m_tail = offset;
+    m_recovered = m_slots.size();
+    m_highWater = m_recovered;
+    updateHead();
+    return true;
+}
+
+FrameSpool::Metadata FrameSpool::metadata() const
+{
+    return m_metadata;
+}
+
+int FrameSpool::recoveredCount() const
+{
+    return m_recovered;
+}
+
+bool FrameSpool::tryPush(const TimedFrame &frame, const QRect &region)
+{
+    const QImage &image = frame.image;
+    if (image.isNull()) {
+        return false;
+    }
+    
+    const qint64 lineBytes = (qint64(image.width()) * image.depth() + 7) / 8;
+    const qint64 stride = (qint64(image.width()) * image.depth() + 31) / 32 * 4;
+    const qint64 bytes = alignRecord(sizeof(RecordHeader) + stride * image.height());
+    
+    // Reserve under the lock, copy without it so encoders keep draining
+    RecordHeader *record;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_closed) {
+            return false;
+        }
+        const qint64 offset = allocate(bytes);
+        if (offset < 0) {
+            return false;
+        }
+        
+        record = reinterpret_cast<RecordHeader *>(m_map + offset);
+        record->magic = RecordMagic;
+        record->state = Writing;
+        record->sequence = frame.sequence;
+        record->timestampNs = frame.timestampNs;
+        record->wallClockMs = frame.wallClockMs;
+        record->x = region.x();
+        record->y = region.y();
+        record->width = image.width();
+        record->height = image.height();
+        record->stride = qint32(stride);
+        record->format = quint32(image.format());
+        record->bytes = quint64(bytes);
+        m_slots.append({offset, false});
+        m_tail = offset + bytes;
+    }
+    
+    uchar *pixels = reinterpret_cast<uchar *>(record + 1);
+    for (int y = 0; y < image.height(); ++y) {
+        std::memcpy(pixels + y * stride, image.constScanLine(y), lineBytes);
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    record->state = Committed;
+    m_highWater = qMax(m_highWater, int(m_slots.size()));
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+bool FrameSpool::pop(TimedFrame *frame)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // Only the frame being pushed right now can be uncommitted
+    auto ready = [this]() {
+        if (m_nextToRead >= m_slots.size()) {
+            return false;
+        }
+        const qint64 offset = m_slots.at(m_nextToRead).offset;
+        return reinterpret_cast<const RecordHeader *>(m_map + offset)->state == Committed;
+    };
+    while (!ready()) {
+        if (m_closed && m_nextToRead >= m_slots.size()) {
+            return false;
+        }
+        m_notEmpty.wait(&m_mutex);
+    }
+    
+    const qint64 offset = m_slots.at(m_nextToRead++).offset;
+    const RecordHeader *record = reinterpret_cast<const RecordHeader *>(m_map + offset);
+    frame->sequence = record->sequence;
+    frame->timestampNs = record->timestampNs;
+    frame->wallClockMs = record->wallClockMs;
+    frame->image = QImage(reinterpret_cast<const uchar *>(record + 1), record->width,
+                          record->height, record->stride, QImage::Format(record->format),
+                          &FrameSpool::releaseImage, new ReleaseInfo{this, offset});
+    return true;
+}
+
+void FrameSpool::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_closed = true;
+    m_notEmpty.wakeAll();
+}
+
+int FrameSpool::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_slots.size();
+}
+
+int FrameSpool::highWater() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_highWater;
+}
+
+QString FrameSpool::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/spool";
+}
+
+QStringList FrameSpool::abandoned()
+{
+    QStringList result;
+    const QDir dir(directory());
+    const QStringList names = dir.entryList(QStringList() << "*.spool", QDir::Files,
+                                            QDir::Time | QDir::Reversed);
+    for (const QString &name : names) {
+        // A running writer holds the lock; QLockFile treats the lock of a
+        // process that is gone as stale and takes it over. Age alone must
+        // not count, or a run longer than the default 30 s looks abandoned.
+        const QString path = dir.filePath(name);
+        QLockFile lock(path + ".lock");
+        lock.setStaleLockTime(0);
+        if (lock.tryLock(0)) {
+            result.append(path);
+        }
+    }
+    return result;
+}
+
+void FrameSpool::releaseImage(void *info)
+{
+    ReleaseInfo *release = static_cast<ReleaseInfo *>(info);
+    release->spool->release(release->offset);
+    delete release;
+}
+
+bool FrameSpool::lock(const QString &path, QString *error)
+{
+    m_lock.reset(new QLockFile(path + ".lock"));
+    m_lock->setStaleLockTime(0);
+    if (!m_lock->tryLock(0)) {
+        m_lock.reset();
+        if (error) {
+            *error = QString("Frame spool %1 is in use").arg(path);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool FrameSpool::map(QString *error)
+{
+    m_map = m_file.map(0, m_capacity);
+    if (!m_map && error) {
+        *error = QString("Cannot map frame spool %1: %2").arg(m_file.fileName(),
+                                                               m_file.errorString());
+    }
+    return m_map != nullptr;
+}
+
+qint64 FrameSpool::allocate(qint64 bytes)
+{
+    // Free space is [tail, end) plus [first record, head) once the tail
+    // is past the head, or [tail, head) after it wrapped. The tail never
+    // catches up with the head, so equal offsets always mean empty.
+    if (m_slots.isEmpty()) {
+        return HeaderSize + bytes <= m_capacity ? HeaderSize : -1;
+    }
+    
+    const qint64 head = m_slots.first().offset;
+    if (m_tail > head) {
+        if (m_tail + bytes <= m_capacity) {
+            return m_tail;
+        }
+        if (HeaderSize + bytes < head) {
+            if (m_tail < m_capacity) {
+                reinterpret_cast<RecordHeader *>(m_map + m_tail)->magic = WrapMagic;
+            }
+            return HeaderSize;
+        }
+        return -1;
+    }
+    return m_tail + bytes < head ? m_tail : -1;
+}
+
+void FrameSpool::release(qint64 offset)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < m_nextToRead; ++i) {
+        if (m_slots.at(i).offset == offset) {
+            m_slots[i].released = true;
+            reinterpret_cast<RecordHeader *>(m_map + offset)->state = Released;
+            break;
+        }
+    }
+    updateHead();
+}
+
+void FrameSpool::updateHead()
+{
+    while (!m_slots.isEmpty() && m_slots.first().released) {
+        m_slots.removeFirst();
+        --m_nextToRead;
+    }
+    
+    // Empty: the next frame starts over at the first record
+    if (m_slots.isEmpty()) {
+        m_tail = HeaderSize;
+    }
+    reinterpret_cast<SpoolHeader *>(m_map)->headOffset =
+        quint64(m_slots.isEmpty() ? HeaderSize : m_slots.first().offset);
+}
@@ -0,0 +1,104 @@
+#ifndef FRAMESPOOL_H
+#define FRAMESPOOL_H
+
+#include "framering.h"
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QRect>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QWaitCondition>
+
+class QLockFile;
+
+// Disk-backed alternative to FrameRing for interval capture. Frames are
+// copied raw into a memory-mapped file of fixed size, each behind a
+// 64-byte header (sequence, timestamps, region, stride, format), and
+// handed to encoders as images that point straight into the mapping.
+// The file is used as a ring: space is reused once the oldest frames are
+// encoded, and a full spool refuses new frames like a full FrameRing.
+// Pages belong to the OS cache rather than the heap, so a slow encoder
+// costs disk space, not memory.
+//
+// Frames are only marked done when the encoder drops its image, so if
+// the process dies, the next run can recover() the spool and encode
+// whatever was left. A lock file next to the spool tells a live writer
+// from an abandoned one.
+class FrameSpool
+{
+public:
+    // What the writer recorded so a later run can finish its job
+    struct Metadata
+    {
+        QString outputDir;
+        QByteArray format;
+        QString presetKey;
+        int framesPerFolder = 0;
+    };
+
+    FrameSpool();
+    // Deletes the file once every frame has been released after close()
+    ~FrameSpool();
+
+    bool create(const QString &path, qint64 capacity, const Metadata &metadata,
+                QString *error = nullptr);
+    // Reopen an abandoned spool; its unreleased frames are queued again
+    bool recover(const QString &path, QString *error = nullptr);
+
+    Metadata metadata() const;
+    int recoveredCount() const;
+
+    // Copy the frame in. Returns false when there is no room or the
+    // spool is closed; the caller counts a drop.
+    bool tryPush(const TimedFrame &frame, const QRect &region);
+
+    // Blocks like FrameRing::pop(). The image points into the spool; the
+    // frame's space is reused once the last copy of it is gone.
+    bool pop(TimedFrame *frame);
+    void close();
+
+    int size() const;
+    int highWater() const;
+
+    // Where spools live, one file per capture session
+    static QString directory();
+    // Spools in directory() whose writer is no longer running
+    static QStringList abandoned();
+
+private:
+    struct Slot
+    {
+        qint64 offset;
+        bool released;
+    };
+
+    struct ReleaseInfo
+    {
+        FrameSpool *spool;
+        qint64 offset;
+    };
+
+    static void releaseImage(void *info);
+    bool lock(const QString &path, QString *error);
+    bool map(QString *error);
+    qint64 allocate(qint64 bytes);
+    void release(qint64 offset);
+    void updateHead();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QFile m_file;
+    QScopedPointer<QLockFile> m_lock;
+    uchar *m_map;
+    qint64 m_capacity;
+    qint64 m_tail;
+    QList<Slot> m_slots;        // Unreleased frames, oldest first
+    int m_nextToRead;           // Index into m_slots
+    int m_highWater;
+    int m_recovered;
+    bool m_closed;
+    Metadata m_metadata;
+};
+
+#endif // FRAMESPOOL_H
@@ -0,0 +1,359 @@
+#include "headlesscapture.h"
+#include "screencapture.h"
+#include "intervalcapture.h"
+#include "regionwatcher.h"
+#include "imageencoder.h"
+#include "instanceserver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+enum ExitCode {
+    ExitOk = 0,
+    ExitUsage = 1,
+    ExitCaptureFailed = 2,
+    ExitWriteFailed = 3
+};
+
+bool parseRegion(const QString &text, QRect *region)
+{
+    const QStringList parts = text.split(',');
+    if (parts.size() != 4) {
+        return false;
+    }
+    
+    int values[4];
+    for (int i = 0; i < 4; ++i) {
+        bool ok = false;
+        values[i] = parts.at(i).trimmed().toInt(&ok);
+        if (!ok) {
+            return false;
+        }
+    }
+    if (values[2] <= 0 || values[3] <= 0) {
+        return false;
+    }
+    
+    *region = QRect(values[0], values[1], values[2], values[3]);
+    return true;
+}
+
+int runInterval(const IntervalCaptureSettings &settings)
+{
+    IntervalCapture capture(settings);
+    IntervalCaptureStats result;
+    
+    QObject::connect(&capture, &IntervalCapture::finished,
+                     [&result](const IntervalCaptureStats &stats) {
+        result = stats;
+        QCoreApplication::quit();
+    });
+    
+    QString error;
+    if (!capture.start(&error)) {
+        QTextStream(stderr) << "cordshot: " << error << "\n";
+        return ExitWriteFailed;
+    }
+    QCoreApplication::exec();
+    
+    QTextStream(stderr) << "cordshot: " << result.summary()
+                        << " • queue peak " << result.ringHighWater << " frames\n";
+    if (result.encoded == 0) {
+        return ExitCaptureFailed;
+    }
+    return result.failed > 0 ? ExitWriteFailed : ExitOk;
+}
+
+int runWatch(const RegionWatchSettings &settings)
+{
+    RegionWatcher watcher(settings);
+    RegionWatchStats result;
+    
+    QObject::connect(&watcher, &RegionWatcher::finished,
+                     [&result](const RegionWatchStats &stats) {
+        result = stats;
+        QCoreApplication::quit();
+    });
+    
+    QString error;
+    if (!watcher.start(&error)) {
+        QTextStream(stderr) << "cordshot: " << error << "\n";
+        return ExitWriteFailed;
+    }
+    QCoreApplication::exec();
+    
+    QTextStream(stderr) << "cordshot: " << result.summary() << "\n";
+    if (result.saved == 0) {
+        return ExitCaptureFailed;
+    }
+    return result.failed > 0 ? ExitWriteFailed : ExitOk;
+}
+
+} // namespace
+
+bool HeadlessCapture::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--out") == 0 || std::strncmp(argv[i], "--out=", 6) == 0 ||
+            std::strcmp(argv[i], "--region") == 0 || std::strncmp(argv[i], "--region=", 9) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int HeadlessCapture::run(const QStringList &arguments, const QElapsedTimer &startTimer)
+{
+    QTextStream err(stderr);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Capture a screen region to a file without opening any windows.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    
+    QCommandLineOption regionOption("region",
+        "Region to capture in logical pixels. Relative to the virtual desktop, "
+        "or to the screen given with --screen. Defaults to the whole screen.",
+        "x,y,w,h");
+    QCommandLineOption screenOption("screen",
+        "Index of the screen to capture from.", "N");
+    QCommandLineOption outOption("out",
+        "File to write, or - for standard output.", "path");
+    QCommandLineOption formatOption("format",
+        "Image format (png, qoi, webp, jpg, bmp, ...). Defaults to the file suffix, "
+        "then the preset's format.", "format");
+    QCommandLineOption presetOption("preset",
+        "Encoder preset: fast-png, max-png, qoi or webp (lossless, when the "
+        "WebP plugin is installed). Defaults to fast-png.", "name");
+    QCommandLineOption timingOption("timing",
+        "Print grab, encode and cold-start-to-file times to standard error.");
+    QCommandLineOption instanceOption("instance",
+        "Have the running Cordshot tray instance grab the region and pass the "
+        "pixels over shared memory. With --timing, the grab time is the round trip.");
+    QCommandLineOption intervalOption("interval",
+        "Capture the region repeatedly every ms milliseconds. --out is then "
+        "a folder, and --count is required.", "ms");
+    QCommandLineOption countOption("count",
+        "Number of frames to capture in interval mode, or of changes to "
+        "save in watch mode.", "N");
+    QCommandLineOption dedupOption("dedup",
+        "Interval mode handling of frames identical to the previous one: "
+        "off, skip, or ref (list them in frames.csv against the previous file). "
+        "Defaults to ref.", "mode");
+    QCommandLineOption spoolOption("spool",
+        "Interval mode: queue frames in a memory-mapped file of MB megabytes "
+        "instead of memory. Frames left by a crash are encoded on the next "
+        "start of the app.", "MB");
+    QCommandLineOption shardOption("shard",
+        "Interval mode: put every N frames in a numbered subfolder of --out.", "N");
+    QCommandLineOption syncOption("sync",
+        "How far files are flushed before they count as written: none (the "
+        "default), file, or directory (the file and its folder entry).", "policy");
+    QCommandLineOption watchOption("watch",
+        "Poll the region every ms milliseconds and save a frame only when it "
+        "changes. --out is then a folder, and --count is required.", "ms");
+    QCommandLineOption thresholdOption("threshold",
+        "Watch mode: percentage of the region that must change before a "
+        "frame is saved. Defaults to 0, any change.", "percent");
+    parser.addOptions({regionOption, screenOption, outOption, formatOption, presetOption,
+                       timingOption, instanceOption, intervalOption, countOption, dedupOption, spoolOption,
+                       shardOption, syncOption, watchOption, thresholdOption});
+    
+    parser.process(arguments);
+    
+    if (!parser.isSet(outOption)) {
+        err << "cordshot: --out is required for command-line capture\n";
+        return ExitUsage;
+    }
+    
+    QRect region;
+    if (parser.isSet(regionOption) && !parseRegion(parser.value(regionOption), &region)) {
+        err << "cordshot: --region expects x,y,w,h with a positive width and height\n";
+        return ExitUsage;
+    }
+    
+    int screenIndex = -1;
+    if (parser.isSet(screenOption)) {
+        bool ok = false;
+        screenIndex = parser.value(screenOption).toInt(&ok);
+        if (!ok || screenIndex < 0) {
+            err << "cordshot: --screen expects a screen index\n";
+            return ExitUsage;
+        }
+    }
+    
+    ImageEncoder::Preset preset = ImageEncoder::FastPng;
+    if (parser.isSet(presetOption)) {
+        const QString name = parser.value(presetOption);
+        preset = ImageEncoder::fromKey(name, ImageEncoder::FastPng);
+        if (ImageEncoder::key(preset) != name) {
+            err << "cordshot: unknown or unavailable preset: " << name << "\n";
+            return ExitUsage;
+        }
+    }
+    
+    const QString outPath = parser.value(outOption);
+    QByteArray format = parser.value(formatOption).toLatin1().toLower();
+    if (format.isEmpty() && outPath != "-") {
+        format = QFileInfo(outPath).suffix().toLatin1().toLower();
+    }
+    if (format.isEmpty()) {
+        format = ImageEncoder::fileSuffix(preset);
+    }
+    if (!ImageEncoder::canWrite(format)) {
+        err << "cordshot: unsupported image format: " << format << "\n";
+        return ExitUsage;
+    }
+    
+    CaptureFileWriter::Options writeOptions;
+    if (parser.isSet(syncOption)) {
+        const QString name = parser.value(syncOption);
+        writeOptions.sync = CaptureFileWriter::syncPolicyFromKey(name, CaptureFileWriter::NoSync);
+        if (CaptureFileWriter::key(writeOptions.sync) != name) {
+            err << "cordshot: --sync expects none, file or directory\n";
+            return ExitUsage;
+        }
+    }
+    
+    if (parser.isSet(intervalOption)) {
+        IntervalCaptureSettings settings;
+        settings.region = region;
+        settings.screenIndex = screenIndex;
+        settings.outputDir = outPath;
+        settings.format = format;
+        settings.preset = preset;
+        settings.sync = writeOptions.sync;
+        
+        bool intervalOk = false;
+        bool countOk = false;
+        settings.intervalMs = parser.value(intervalOption).toInt(&intervalOk);
+        settings.frameLimit = parser.value(countOption).toInt(&countOk);
+        if (!intervalOk || settings.intervalMs <= 0 || !countOk || settings.frameLimit <= 0) {
+            err << "cordshot: --interval and --count expect positive numbers\n";
+            return ExitUsage;
+        }
+        if (outPath == "-") {
+            err << "cordshot: interval mode writes to a folder, not standard output\n";
+            return ExitUsage;
+        }
+        
+        const QString dedup = parser.value(dedupOption);
+        if (dedup == "off") {
+            settings.dedup = IntervalCaptureSettings::DedupOff;
+        } else if (dedup == "skip") {
+            settings.dedup = IntervalCaptureSettings::DedupSkip;
+        } else if (dedup.isEmpty() || dedup == "ref") {
+            settings.dedup = IntervalCaptureSettings::DedupReference;
+        } else {
+            err << "cordshot: --dedup expects off, skip or ref\n";
+            return ExitUsage;
+        }
+        
+        if (parser.isSet(spoolOption)) {
+            bool spoolOk = false;
+            settings.spoolBytes = parser.value(spoolOption).toLongLong(&spoolOk) * 1024 * 1024;
+            if (!spoolOk || settings.spoolBytes <= 0) {
+                err << "cordshot: --spool expects a size in megabytes\n";
+                return ExitUsage;
+            }
+        }
+        if (parser.isSet(shardOption)) {
+            bool shardOk = false;
+            settings.framesPerFolder = parser.value(shardOption).toInt(&shardOk);
+            if (!shardOk || settings.framesPerFolder <= 0) {
+                err << "cordshot: --shard expects a positive number of frames\n";
+                return ExitUsage;
+            }
+        }
+        return runInterval(settings);
+    }
+    
+    if (parser.isSet(watchOption)) {
+        RegionWatchSettings settings;
+        settings.region = region;
+        settings.screenIndex = screenIndex;
+        settings.outputDir = outPath;
+        settings.format = format;
+        settings.preset = preset;
+        settings.sync = writeOptions.sync;
+        
+        bool pollOk = false;
+        bool countOk = false;
+        settings.pollMs = parser.value(watchOption).toInt(&pollOk);
+        settings.changeLimit = parser.value(countOption).toInt(&countOk);
+        if (!pollOk || settings.pollMs <= 0 || !countOk || settings.changeLimit <= 0) {
+            err << "cordshot: --watch and --count expect positive numbers\n";
+            return ExitUsage;
+        }
+        if (parser.isSet(thresholdOption)) {
+            bool thresholdOk = false;
+            settings.thresholdPercent = parser.value(thresholdOption).toDouble(&thresholdOk);
+            if (!thresholdOk || settings.thresholdPercent < 0.0 ||
+                settings.thresholdPercent >= 100.0) {
+                err << "cordshot: --threshold expects a percentage below 100\n";
+                return ExitUsage;
+            }
+        }
+        if (outPath == "-") {
+            err << "cordshot: watch mode writes to a folder, not standard output\n";
+            return ExitUsage;
+        }
+        return runWatch(settings);
+    }
+    
+    // Grab
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    
+    QString error;
+    QImage image;
+    if (parser.isSet(instanceOption)) {
+        image = InstanceClient::grab(region, screenIndex, &error);
+    } else {
+        image = ScreenCapture::grabRegion(region, screenIndex, &error);
+    }
+    if (image.isNull()) {
+        err << "cordshot: " << error << "\n";
+        return ExitCaptureFailed;
+    }
+    const qint64 grabUs = stageTimer.nsecsElapsed() / 1000;
+    
+    // Encode and write
+    EncodeResult result;
+    if (outPath == "-") {
+        QFile file;
+        if (!file.open(stdout, QIODevice::WriteOnly)) {
+            err << "cordshot: cannot open standard output: " << file.errorString() << "\n";
+            return ExitWriteFailed;
+        }
+        result = ImageEncoder::encode(image, &file, format, preset);
+    } else {
+        // Published whole, so a script waiting for the file never reads
+        // half of it
+        EncodedImage encoded(image, format, preset);
+        result = ImageEncoder::write(encoded, outPath, writeOptions);
+    }
+    if (!result.ok) {
+        err << "cordshot: failed to write " << outPath << ": " << result.error << "\n";
+        return ExitWriteFailed;
+    }
+    
+    if (parser.isSet(timingOption)) {
+        err << QString("cordshot: %1×%2 • grab %3 ms%4 • encode %5 • cold start to file %6 ms\n")
+               .arg(image.width())
+               .arg(image.height())
+               .arg(grabUs / 1000.0, 0, 'f', 1)
+               .arg(parser.isSet(instanceOption) ? " via instance" : "")
+               .arg(result.summary())
+               .arg(startTimer.nsecsElapsed() / 1000000.0, 0, 'f', 1);
+    }
+    
+    return ExitOk;
+}
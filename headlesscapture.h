@@ -0,0 +1,24 @@
+#ifndef HEADLESSCAPTURE_H
+#define HEADLESSCAPTURE_H
+
+#include <QStringList>
+
+class QElapsedTimer;
+
+// Command-line capture mode: grab, crop, encode, write and exit, without
+// creating any widgets. Works on the offscreen and xcb (Xvfb) platforms.
+//
+//   cordshot --region x,y,w,h [--screen N] --out path [--format png] [--timing]
+class HeadlessCapture
+{
+public:
+    // True when the arguments ask for a command-line capture. Checked
+    // before any QGuiApplication exists, so it looks at argv directly.
+    static bool isRequested(int argc, char *argv[]);
+
+    // Runs the capture and returns the process exit code. startTimer is
+    // started at the top of main() and gives the cold-start-to-file time.
+    static int run(const QStringList &arguments, const QElapsedTimer &startTimer);
+};
+
+#endif // HEADLESSCAPTURE_H
@@ -0,0 +1,400 @@
+#include "imageencoder.h"
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QMutexLocker>
+#include <QStringList>
+#include <cstring>
+
+namespace {
+
+// QImageWriter maps PNG quality q to zlib level (100 - q) * 9 / 91
+const int FastPngQuality = 85;      // Level 1
+const int MaxPngQuality = 0;        // Level 9
+// Qt's WebP plugin switches to lossless mode at quality 100
+const int WebpLosslessQuality = 100;
+
+const uchar QoiOpIndex = 0x00;
+const uchar QoiOpDiff = 0x40;
+const uchar QoiOpLuma = 0x80;
+const uchar QoiOpRun = 0xc0;
+const uchar QoiOpRgb = 0xfe;
+const uchar QoiOpRgba = 0xff;
+const int QoiHeaderSize = 14;
+const uchar QoiEndMarker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+void putBigEndian32(uchar *out, quint32 value)
+{
+    out[0] = uchar(value >> 24);
+    out[1] = uchar(value >> 16);
+    out[2] = uchar(value >> 8);
+    out[3] = uchar(value);
+}
+
+// Encode rows of 0xAARRGGBB pixels; returns the number of bytes written
+// to out, which must hold the worst case of 5 bytes per pixel
+qint64 encodeQoiPixels(const uchar *bits, qsizetype stride, int width, int height,
+                       bool hasAlpha, uchar *out)
+{
+    uchar *p = out;
+    QRgb index[64];
+    std::memset(index, 0, sizeof(index));
+    
+    QRgb previous = 0xff000000;
+    int run = 0;
+    const QRgb alphaMask = hasAlpha ? 0 : 0xff000000;
+    
+    for (int y = 0; y < height; ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(bits + y * stride);
+        const bool lastRow = y == height - 1;
+        for (int x = 0; x < width; ++x) {
+            const QRgb pixel = line[x] | alphaMask;
+            
+            if (pixel == previous) {
+                ++run;
+                if (run == 62 || (lastRow && x == width - 1)) {
+                    *p++ = QoiOpRun | uchar(run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+            
+            if (run > 0) {
+                *p++ = QoiOpRun | uchar(run - 1);
+                run = 0;
+            }
+            
+            const int r = qRed(pixel);
+            const int g = qGreen(pixel);
+            const int b = qBlue(pixel);
+            const int a = qAlpha(pixel);
+            const int slot = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+            
+            if (index[slot] == pixel) {
+                *p++ = QoiOpIndex | uchar(slot);
+            } else {
+                index[slot] = pixel;
+                
+                if (a == qAlpha(previous)) {
+                    const signed char dr = static_cast<signed char>(r - qRed(previous));
+                    const signed char dg = static_cast<signed char>(g - qGreen(previous));
+                    const signed char db = static_cast<signed char>(b - qBlue(previous));
+                    const signed char drg = static_cast<signed char>(dr - dg);
+                    const signed char dbg = static_cast<signed char>(db - dg);
+                    
+                    if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+                        *p++ = QoiOpDiff | uchar((dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                    } else if (drg > -9 && drg < 8 && dg > -33 && dg < 32 &&
+                               dbg > -9 && dbg < 8) {
+                        *p++ = QoiOpLuma | uchar(dg + 32);
+                        *p++ = uchar((drg + 8) << 4 | (dbg + 8));
+                    } else {
+                        *p++ = QoiOpRgb;
+                        *p++ = uchar(r);
+                        *p++ = uchar(g);
+                        *p++ = uchar(b);
+                    }
+                } else {
+                    *p++ = QoiOpRgba;
+                    *p++ = uchar(r);
+                    *p++ = uchar(g);
+                    *p++ = uchar(b);
+                    *p++ = uchar(a);
+                }
+            }
+            previous = pixel;
+        }
+    }
+    
+    return p - out;
+}
+
+} // namespace
+
+QString EncodeResult::summary() const
+{
+    QString text = reused ? QString("reused")
+                          : QString("%1 ms").arg(encodeUs / 1000.0, 0, 'f', 1);
+    if (writeUs > 0) {
+        text += QString(" + %1 ms write").arg(writeUs / 1000.0, 0, 'f', 1);
+    }
+    if (bytes >= 0) {
+        text += QString(" • %1 KB").arg((bytes + 512) / 1024);
+    }
+    return text;
+}
+
+QVector<ImageEncoder::Preset> ImageEncoder::availablePresets()
+{
+    QVector<Preset> presets;
+    for (Preset preset : {FastPng, MaxPng, Qoi, WebpLossless}) {
+        if (isAvailable(preset)) {
+            presets.append(preset);
+        }
+    }
+    return presets;
+}
+
+bool ImageEncoder::isAvailable(Preset preset)
+{
+    if (preset == WebpLossless) {
+        return QImageWriter::supportedImageFormats().contains("webp");
+    }
+    return true;
+}
+
+QString ImageEncoder::displayName(Preset preset)
+{
+    switch (preset) {
+    case FastPng:
+        return "PNG (fast)";
+    case MaxPng:
+        return "PNG (smallest)";
+    case Qoi:
+        return "QOI";
+    case WebpLossless:
+        return "WebP (lossless)";
+    }
+    return QString();
+}
+
+QString ImageEncoder::key(Preset preset)
+{
+    switch (preset) {
+    case FastPng:
+        return "fast-png";
+    case MaxPng:
+        return "max-png";
+    case Qoi:
+        return "qoi";
+    case WebpLossless:
+        return "webp";
+    }
+    return QString();
+}
+
+ImageEncoder::Preset ImageEncoder::fromKey(const QString &key, Preset fallback)
+{
+    for (Preset preset : {FastPng, MaxPng, Qoi, WebpLossless}) {
+        if (key == ImageEncoder::key(preset)) {
+            return isAvailable(preset) ? preset : fallback;
+        }
+    }
+    return fallback;
+}
+
+QByteArray ImageEncoder::fileSuffix(Preset preset)
+{
+    switch (preset) {
+    case FastPng:
+    case MaxPng:
+        return "png";
+    case Qoi:
+        return "qoi";
+    case WebpLossless:
+        return "webp";
+    }
+    return "png";
+}
+
+QString ImageEncoder::fileDialogFilter(Preset preset)
+{
+    QStringList filters;
+    filters << "PNG Image (*.png)" << "QOI Image (*.qoi)";
+    if (isAvailable(WebpLossless)) {
+        filters << "WebP Image (*.webp)";
+    }
+    filters << "JPEG Image (*.jpg *.jpeg)" << "All Files (*.*)";
+    
+    // QFileDialog preselects the first entry
+    const QString suffix = "*." + QString::fromLatin1(fileSuffix(preset));
+    for (int i = 0; i < filters.size(); ++i) {
+        if (filters.at(i).contains(suffix)) {
+            filters.move(i, 0);
+            break;
+        }
+    }
+    return filters.join(";;");
+}
+
+bool ImageEncoder::canWrite(const QByteArray &format)
+{
+    return format == "qoi" || QImageWriter::supportedImageFormats().contains(format);
+}
+
+EncodeResult ImageEncoder::encode(const QImage &image, QIODevice *device,
+                                  const QByteArray &format, Preset preset)
+{
+    EncodeResult result;
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 startPos = device->isSequential() ? 0 : device->pos();
+    
+    if (format == "qoi") {
+        const QByteArray data = encodeQoi(image);
+        result.ok = !data.isEmpty() && device->write(data) == data.size();
+        if (!result.ok) {
+            result.error = data.isEmpty() ? QString("Cannot encode an empty image")
+                                          : device->errorString();
+        }
+    } else {
+        QImageWriter writer(device, format);
+        if (format == fileSuffix(preset)) {
+            switch (preset) {
+            case FastPng:
+                writer.setQuality(FastPngQuality);
+                break;
+            case MaxPng:
+                writer.setQuality(MaxPngQuality);
+                break;
+            case WebpLossless:
+                writer.setQuality(WebpLosslessQuality);
+                break;
+            case Qoi:
+                break;
+            }
+        }
+        result.ok = writer.write(image);
+        if (!result.ok) {
+            result.error = writer.errorString();
+        }
+    }
+    
+    result.encodeUs = timer.nsecsElapsed() / 1000;
+    if (result.ok && !device->isSequential()) {
+        result.bytes = device->pos() - startPos;
+    }
+    return result;
+}
+
+QByteArray ImageEncoder::formatForPath(const QString &filePath, Preset preset)
+{
+    QByteArray format = QFileInfo(filePath).suffix().toLatin1().toLower();
+    if (format == "jpeg") {
+        format = "jpg";
+    } else if (format.isEmpty()) {
+        format = fileSuffix(preset);
+    }
+    return format;
+}
+
+EncodeResult ImageEncoder::write(const QImage &image, const QString &filePath, Preset preset,
+                                 const CaptureFileWriter::Options &options)
+{
+    EncodedImage encoded(image, formatForPath(filePath, preset), preset);
+    return write(encoded, filePath, options);
+}
+
+EncodeResult ImageEncoder::write(EncodedImage &encoded, const QString &filePath,
+                                 const CaptureFileWriter::Options &options)
+{
+    // Encoded in memory first, so encode and disk time are measured
+    // separately and the bytes can be shared
+    EncodeResult result;
+    const QByteArray data = encoded.data(&result);
+    result.filePath = filePath;
+    
+    if (result.ok) {
+        // Never leaves a truncated file behind, nor replaces a good one
+        // with it
+        QElapsedTimer timer;
+        timer.start();
+        result.ok = CaptureFileWriter::write(data, &result.filePath, options, &result.error);
+        result.writeUs = timer.nsecsElapsed() / 1000;
+    }
+    return result;
+}
+
+QByteArray ImageEncoder::encodeQoi(const QImage &image)
+{
+    if (image.isNull()) {
+        return QByteArray();
+    }
+    
+    // The encoder reads straight (non-premultiplied) 0xAARRGGBB pixels
+    const bool hasAlpha = image.hasAlphaChannel();
+    const QImage source = image.convertToFormat(hasAlpha ? QImage::Format_ARGB32
+                                                         : QImage::Format_RGB32);
+    
+    const int width = source.width();
+    const int height = source.height();
+    const qint64 worstCase = QoiHeaderSize + qint64(width) * height * 5 + sizeof(QoiEndMarker);
+    QByteArray data(worstCase, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(data.data());
+    
+    std::memcpy(out, "qoif", 4);
+    putBigEndian32(out + 4, quint32(width));
+    putBigEndian32(out + 8, quint32(height));
+    out[12] = hasAlpha ? 4 : 3;
+    out[13] = 0;    // sRGB with linear alpha
+    
+    qint64 size = QoiHeaderSize;
+    size += encodeQoiPixels(source.constBits(), source.bytesPerLine(), width, height,
+                            hasAlpha, out + size);
+    std::memcpy(out + size, QoiEndMarker, sizeof(QoiEndMarker));
+    size += sizeof(QoiEndMarker);
+    
+    data.truncate(size);
+    return data;
+}
+
+EncodedImage::EncodedImage(const QImage &image, const QByteArray &format,
+                           ImageEncoder::Preset preset)
+    : m_image(image)
+    , m_format(format)
+    , m_preset(preset)
+    , m_encoded(false)
+{
+}
+
+QImage EncodedImage::image() const
+{
+    return m_image;
+}
+
+QByteArray EncodedImage::format() const
+{
+    return m_format;
+}
+
+ImageEncoder::Preset EncodedImage::preset() const
+{
+    return m_preset;
+}
+
+bool EncodedImage::isEncoded() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_encoded;
+}
+
+QByteArray EncodedImage::data(EncodeResult *result)
+{
+    // Held across the encode so a concurrent caller waits for these
+    // bytes instead of producing its own
+    QMutexLocker locker(&m_mutex);
+    
+    EncodeResult encodeResult;
+    if (m_encoded) {
+        encodeResult.reused = true;
+    } else {
+        QBuffer buffer(&m_data);
+        buffer.open(QIODevice::WriteOnly);
+        encodeResult = ImageEncoder::encode(m_image, &buffer, m_format, m_preset);
+        buffer.close();
+        if (!encodeResult.ok) {
+            m_data.clear();
+            m_error = encodeResult.error;
+        }
+        m_encoded = true;
+    }
+    
+    encodeResult.ok = !m_data.isEmpty();
+    encodeResult.error = m_error;
+    encodeResult.bytes = m_data.size();
+    if (result) {
+        *result = encodeResult;
+    }
+    return m_data;
+}
@@ -0,0 +1,102 @@
+#ifndef IMAGEENCODER_H
+#define IMAGEENCODER_H
+
+#include <QImage>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMutex>
+#include <QSharedPointer>
+#include "capturefilewriter.h"
+
+class QIODevice;
+class EncodedImage;
+
+struct EncodeResult
+{
+    QString filePath;
+    bool ok = false;
+    QString error;
+    qint64 bytes = -1;         // Unknown when written to a sequential device
+    qint64 encodeUs = 0;       // Encoding; includes the output device for encode()
+    qint64 writeUs = 0;        // Writing the encoded file, for write()
+    bool reused = false;       // Bytes came from an earlier encode of the same image
+
+    QString summary() const;
+};
+
+// Encoder back-ends for saved captures. A preset picks the file format
+// and how much time is spent compressing; the default favours time to
+// disk over file size.
+class ImageEncoder
+{
+public:
+    enum Preset {
+        FastPng,        // zlib level 1
+        MaxPng,         // zlib level 9
+        Qoi,            // Quite OK Image format, built in
+        WebpLossless    // Only when Qt's WebP plugin is installed
+    };
+
+    static QVector<Preset> availablePresets();
+    static bool isAvailable(Preset preset);
+
+    static QString displayName(Preset preset);
+    // Stable name stored in QSettings and accepted on the command line
+    static QString key(Preset preset);
+    static Preset fromKey(const QString &key, Preset fallback = FastPng);
+    static QByteArray fileSuffix(Preset preset);
+
+    // Filter list for QFileDialog with the preset's format first
+    static QString fileDialogFilter(Preset preset);
+    // True for formats this class or Qt's image writers can produce
+    static bool canWrite(const QByteArray &format);
+    // Format a file will be written in: its suffix, or the preset's
+    static QByteArray formatForPath(const QString &filePath, Preset preset);
+
+    // Encode with the preset when format is its suffix, otherwise with
+    // Qt's default writer for format
+    static EncodeResult encode(const QImage &image, QIODevice *device,
+                               const QByteArray &format, Preset preset);
+    // Same, with the format taken from the file suffix. The file is
+    // encoded in memory, then published in one go by CaptureFileWriter;
+    // the result's filePath is where it ended up.
+    static EncodeResult write(const QImage &image, const QString &filePath, Preset preset,
+                              const CaptureFileWriter::Options &options = CaptureFileWriter::Options());
+    // Write the bytes of a shared encode, encoding first if no one has yet
+    static EncodeResult write(EncodedImage &encoded, const QString &filePath,
+                              const CaptureFileWriter::Options &options = CaptureFileWriter::Options());
+
+    static QByteArray encodeQoi(const QImage &image);
+};
+
+// An image and its encoded bytes, produced at most once. The clipboard
+// and the save queue share one of these per capture, so whichever asks
+// first pays for the encode and the other reuses it. Safe to use from
+// any thread; a second caller waits for an encode already running.
+class EncodedImage
+{
+public:
+    EncodedImage(const QImage &image, const QByteArray &format, ImageEncoder::Preset preset);
+
+    QImage image() const;
+    QByteArray format() const;
+    ImageEncoder::Preset preset() const;
+    bool isEncoded() const;
+
+    // Empty if encoding failed; result, if given, describes this call
+    QByteArray data(EncodeResult *result = nullptr);
+
+private:
+    mutable QMutex m_mutex;
+    const QImage m_image;
+    const QByteArray m_format;
+    const ImageEncoder::Preset m_preset;
+    QByteArray m_data;
+    QString m_error;
+    bool m_encoded;
+};
+
+typedef QSharedPointer<EncodedImage> SharedEncodedImage;
+
+#endif // IMAGEENCODER_H
@@ -0,0 +1,546 @@
+#include "imageops.h"
+#include <QThreadPool>
+#include <QSemaphore>
+#include <functional>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGEOPS_SSE2
+#endif
+
+namespace {
+
+// Rows per parallel job; small enough to spread an 8K frame over all cores
+const int StripeRows = 128;
+
+// Split [0, rows) into stripes and run them on the global pool, with the
+// calling thread taking the first stripe
+void runStripes(int rows, int rowsPerStripe, const std::function<void(int, int)> &job)
+{
+    const int stripes = (rows + rowsPerStripe - 1) / rowsPerStripe;
+    if (stripes <= 1) {
+        job(0, rows);
+        return;
+    }
+    
+    QSemaphore done;
+    for (int i = 1; i < stripes; ++i) {
+        const int first = i * rowsPerStripe;
+        const int last = qMin(rows, first + rowsPerStripe);
+        QThreadPool::globalInstance()->start([&job, &done, first, last]() {
+            job(first, last);
+            done.release();
+        });
+    }
+    job(0, qMin(rows, rowsPerStripe));
+    done.acquire(stripes - 1);
+}
+
+// xxHash64 primes and round; four independent lanes per tile keep the
+// multiplies pipelined and let the compiler vectorise the inner loop
+const quint64 Prime1 = 0x9E3779B185EBCA87ULL;
+const quint64 Prime2 = 0xC2B2AE3D27D4EB4FULL;
+const quint64 Prime3 = 0x165667B19E3779F9ULL;
+
+inline quint64 rotl64(quint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline quint64 hashRound(quint64 acc, quint64 input)
+{
+    acc += input * Prime2;
+    acc = rotl64(acc, 31);
+    return acc * Prime1;
+}
+
+struct TileHashState
+{
+    quint64 lanes[4];
+};
+
+// Feed one row segment of a tile (count pixels) into its hash state
+inline void hashTileRow(TileHashState &state, const quint32 *pixels, int count)
+{
+    // Two pixels per 64-bit word; memcpy keeps the loads alignment-safe
+    // and compiles to plain moves
+    const uchar *bytes = reinterpret_cast<const uchar *>(pixels);
+    const int wordCount = count / 2;
+    quint64 words[4];
+    int i = 0;
+    for (; i + 4 <= wordCount; i += 4) {
+        std::memcpy(words, bytes + i * 8, sizeof(words));
+        state.lanes[0] = hashRound(state.lanes[0], words[0]);
+        state.lanes[1] = hashRound(state.lanes[1], words[1]);
+        state.lanes[2] = hashRound(state.lanes[2], words[2]);
+        state.lanes[3] = hashRound(state.lanes[3], words[3]);
+    }
+    for (; i < wordCount; ++i) {
+        std::memcpy(words, bytes + i * 8, 8);
+        state.lanes[i & 3] = hashRound(state.lanes[i & 3], words[0]);
+    }
+    if (count & 1) {
+        state.lanes[0] = hashRound(state.lanes[0], pixels[count - 1]);
+    }
+}
+
+inline quint64 finishTileHash(const TileHashState &state)
+{
+    quint64 h = rotl64(state.lanes[0], 1) + rotl64(state.lanes[1], 7) +
+                rotl64(state.lanes[2], 12) + rotl64(state.lanes[3], 18);
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// x * factor / 255 for the two 8-bit lanes held in 0x00FF00FF,
+// rounded the same way as Qt's own blending
+inline quint32 scaleLanes(quint32 lanes, quint32 factor)
+{
+    quint32 t = lanes * factor + 0x00800080;
+    t = (t + ((t >> 8) & 0x00FF00FF)) >> 8;
+    return t & 0x00FF00FF;
+}
+
+void dimRow(const quint32 *src, quint32 *dst, int count, quint32 factor)
+{
+    int x = 0;
+
+#ifdef IMAGEOPS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mul = _mm_set1_epi16(static_cast<short>(factor));
+    const __m128i half = _mm_set1_epi16(0x80);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    
+    for (; x + 4 <= count; x += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        
+        // Widen to 16 bits per channel, multiply and divide by 255
+        __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+        __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, mul), half);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, mul), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        
+        // Keep the original alpha
+        __m128i result = _mm_packus_epi16(lo, hi);
+        result = _mm_or_si128(_mm_andnot_si128(alphaMask, result),
+                              _mm_and_si128(alphaMask, pixels));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), result);
+    }
+#endif
+    
+    for (; x < count; ++x) {
+        const quint32 p = src[x];
+        const quint32 rb = scaleLanes(p & 0x00FF00FF, factor);
+        const quint32 g = scaleLanes((p >> 8) & 0x000000FF, factor);
+        dst[x] = (p & 0xFF000000) | rb | (g << 8);
+    }
+}
+
+// Resampling weights are fixed point with this many fraction bits; small
+// enough that a 16-bit weight times an 8-bit channel fits _mm_madd_epi16
+const int WeightBits = 14;
+
+// Source span of one output pixel along one axis and where its weights
+// start in the shared weight list
+struct Contribution
+{
+    int first;
+    int count;
+    int weights;
+};
+
+// Area sampling: output pixel i covers [i * scale, (i + 1) * scale) of
+// the source and each source pixel is weighted by how much of it falls
+// inside. Weights of one output pixel sum to exactly 1 << WeightBits.
+QVector<Contribution> areaContributions(int srcSize, int dstSize, QVector<qint16> *weights)
+{
+    const double scale = double(srcSize) / dstSize;
+    QVector<Contribution> result(dstSize);
+    for (int i = 0; i < dstSize; ++i) {
+        const double start = i * scale;
+        const double end = qMin(double(srcSize), start + scale);
+        Contribution &c = result[i];
+        c.first = qMin(srcSize - 1, int(start));
+        c.count = qMax(1, qMin(srcSize, int(std::ceil(end))) - c.first);
+        c.weights = weights->size();
+        
+        int total = 0;
+        int largest = 0;
+        for (int s = 0; s < c.count; ++s) {
+            const double pixel = c.first + s;
+            const double cover = qMin(end, pixel + 1.0) - qMax(start, pixel);
+            const int weight = qMax(0, int(cover / scale * (1 << WeightBits) + 0.5));
+            weights->append(qint16(weight));
+            total += weight;
+            if (weight > weights->at(c.weights + largest)) {
+                largest = s;
+            }
+        }
+        // Rounding leftovers go to the largest tap
+        (*weights)[c.weights + largest] += qint16((1 << WeightBits) - total);
+    }
+    return result;
+}
+
+void resampleRow(const quint32 *src, quint32 *dst, int count,
+                 const Contribution *columns, const qint16 *weights)
+{
+    for (int x = 0; x < count; ++x) {
+        const Contribution &c = columns[x];
+        const quint32 *px = src + c.first;
+        const qint16 *w = weights + c.weights;
+
+#ifdef IMAGEOPS_SSE2
+        // Two taps per _mm_madd_epi16: channels of both pixels interleaved
+        // as 16-bit pairs against their pair of weights
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_set1_epi32(1 << (WeightBits - 1));
+        int t = 0;
+        for (; t + 1 < c.count; t += 2) {
+            const __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(px[t])), zero);
+            const __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(px[t + 1])), zero);
+            const __m128i pair = _mm_set1_epi32(int((quint32(quint16(w[t + 1])) << 16) | quint16(w[t])));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pair));
+        }
+        if (t < c.count) {
+            const __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(px[t])), zero);
+            const __m128i single = _mm_set1_epi32(quint16(w[t]));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), single));
+        }
+        acc = _mm_srai_epi32(acc, WeightBits);
+        acc = _mm_packs_epi32(acc, acc);
+        dst[x] = quint32(_mm_cvtsi128_si32(_mm_packus_epi16(acc, acc)));
+#else
+        int acc[4] = {1 << (WeightBits - 1), 1 << (WeightBits - 1),
+                      1 << (WeightBits - 1), 1 << (WeightBits - 1)};
+        for (int t = 0; t < c.count; ++t) {
+            const quint32 p = px[t];
+            acc[0] += int(p & 0xFF) * w[t];
+            acc[1] += int((p >> 8) & 0xFF) * w[t];
+            acc[2] += int((p >> 16) & 0xFF) * w[t];
+            acc[3] += int(p >> 24) * w[t];
+        }
+        dst[x] = quint32(qBound(0, acc[0] >> WeightBits, 255))
+               | quint32(qBound(0, acc[1] >> WeightBits, 255)) << 8
+               | quint32(qBound(0, acc[2] >> WeightBits, 255)) << 16
+               | quint32(qBound(0, acc[3] >> WeightBits, 255)) << 24;
+#endif
+    }
+}
+
+// Weighted sum of c.count source rows into one output row
+void resampleColumn(const uchar *srcBits, qsizetype srcStride, quint32 *dst, int width,
+                    const Contribution &c, const qint16 *weights)
+{
+    int x = 0;
+
+#ifdef IMAGEOPS_SSE2
+    // Four pixels at a time, two rows per _mm_madd_epi16
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (WeightBits - 1));
+    for (; x + 4 <= width; x += 4) {
+        __m128i acc0 = round;
+        __m128i acc1 = round;
+        __m128i acc2 = round;
+        __m128i acc3 = round;
+        for (int t = 0; t < c.count; t += 2) {
+            const uchar *rowA = srcBits + (c.first + t) * srcStride + x * 4;
+            const bool paired = t + 1 < c.count;
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rowA));
+            const __m128i b = paired
+                ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(rowA + srcStride))
+                : zero;
+            const quint16 wb = paired ? quint16(weights[c.weights + t + 1]) : 0;
+            const __m128i pair = _mm_set1_epi32(int((quint32(wb) << 16)
+                                                    | quint16(weights[c.weights + t])));
+            
+            const __m128i aLo = _mm_unpacklo_epi8(a, zero);
+            const __m128i aHi = _mm_unpackhi_epi8(a, zero);
+            const __m128i bLo = _mm_unpacklo_epi8(b, zero);
+            const __m128i bHi = _mm_unpackhi_epi8(b, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), pair));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), pair));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), pair));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), pair));
+        }
+        const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(acc0, WeightBits),
+                                           _mm_srai_epi32(acc1, WeightBits));
+        const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(acc2, WeightBits),
+                                           _mm_srai_epi32(acc3, WeightBits));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    
+    for (; x < width; ++x) {
+        int acc[4] = {1 << (WeightBits - 1), 1 << (WeightBits - 1),
+                      1 << (WeightBits - 1), 1 << (WeightBits - 1)};
+        for (int t = 0; t < c.count; ++t) {
+            const quint32 p = reinterpret_cast<const quint32 *>(
+                srcBits + (c.first + t) * srcStride)[x];
+            const int w = weights[c.weights + t];
+            acc[0] += int(p & 0xFF) * w;
+            acc[1] += int((p >> 8) & 0xFF) * w;
+            acc[2] += int((p >> 16) & 0xFF) * w;
+            acc[3] += int(p >> 24) * w;
+        }
+        dst[x] = quint32(qBound(0, acc[0] >> WeightBits, 255))
+               | quint32(qBound(0, acc[1] >> WeightBits, 255)) << 8
+               | quint32(qBound(0, acc[2] >> WeightBits, 255)) << 16
+               | quint32(qBound(0, acc[3] >> WeightBits, 255)) << 24;
+    }
+}
+
+} // namespace
+
+QImage ImageOps::regionView(const QImage &image, const QRect &rect)
+{
+    const QRect bounded = rect.intersected(image.rect());
+    if (bounded.isEmpty()) {
+        return QImage();
+    }
+    if (bounded == image.rect()) {
+        // The whole image: a plain shared copy pins nothing extra
+        return image;
+    }
+    if (image.depth() % 8 != 0) {
+        // Sub-byte formats cannot start a row mid-byte
+        return image.copy(bounded);
+    }
+    
+    // The cleanup function owns a shallow copy of the source, so its
+    // buffer outlives every copy of the view and is freed with the last one
+    QImage *owner = new QImage(image);
+    const uchar *origin = owner->constBits() +
+                          bounded.y() * owner->bytesPerLine() +
+                          bounded.x() * (owner->depth() / 8);
+    return QImage(origin, bounded.width(), bounded.height(), owner->bytesPerLine(),
+                  owner->format(),
+                  [](void *info) { delete static_cast<QImage *>(info); }, owner);
+}
+
+QImage ImageOps::dimmed(const QImage &image, int alpha)
+{
+    if (image.isNull() || image.depth() != 32) {
+        return image;
+    }
+    
+    QImage result(image.size(), image.format());
+    if (result.isNull()) {
+        return result;
+    }
+    
+    const quint32 factor = static_cast<quint32>(255 - qBound(0, alpha, 255));
+    const int width = image.width();
+    const uchar *srcBits = image.constBits();
+    const qsizetype srcStride = image.bytesPerLine();
+    uchar *dstBits = result.bits();
+    const qsizetype dstStride = result.bytesPerLine();
+    
+    runStripes(image.height(), StripeRows, [=](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            dimRow(reinterpret_cast<const quint32 *>(srcBits + y * srcStride),
+                   reinterpret_cast<quint32 *>(dstBits + y * dstStride),
+                   width, factor);
+        }
+    });
+    
+    return result;
+}
+
+QVector<quint64> ImageOps::tileHashes(const QImage &image, int tileSize)
+{
+    if (image.isNull() || image.depth() != 32 || tileSize <= 0) {
+        return QVector<quint64>();
+    }
+    
+    const int width = image.width();
+    const int height = image.height();
+    const int tilesX = (width + tileSize - 1) / tileSize;
+    const int tilesY = (height + tileSize - 1) / tileSize;
+    QVector<quint64> hashes(tilesX * tilesY);
+    
+    const uchar *bits = image.constBits();
+    const qsizetype stride = image.bytesPerLine();
+    quint64 *out = hashes.data();
+    
+    // Rows are read top to bottom so memory is streamed once; each tile
+    // row keeps one hash state per tile column
+    runStripes(tilesY, 4, [=](int firstTileRow, int lastTileRow) {
+        QVector<TileHashState> states(tilesX);
+        for (int tileRow = firstTileRow; tileRow < lastTileRow; ++tileRow) {
+            for (int tx = 0; tx < tilesX; ++tx) {
+                // Seed with the tile position so equal tiles at different
+                // places do not hash alike
+                const quint64 seed = (static_cast<quint64>(tileRow) << 32) | static_cast<quint32>(tx);
+                states[tx].lanes[0] = seed + Prime1 + Prime2;
+                states[tx].lanes[1] = seed + Prime2;
+                states[tx].lanes[2] = seed;
+                states[tx].lanes[3] = seed - Prime1;
+            }
+            
+            const int firstRow = tileRow * tileSize;
+            const int lastRow = qMin(height, firstRow + tileSize);
+            for (int y = firstRow; y < lastRow; ++y) {
+                const quint32 *line = reinterpret_cast<const quint32 *>(bits + y * stride);
+                for (int tx = 0; tx < tilesX; ++tx) {
+                    const int x = tx * tileSize;
+                    hashTileRow(states[tx], line + x, qMin(tileSize, width - x));
+                }
+            }
+            
+            for (int tx = 0; tx < tilesX; ++tx) {
+                out[tileRow * tilesX + tx] = finishTileHash(states[tx]);
+            }
+        }
+    });
+    
+    return hashes;
+}
+
+QImage ImageOps::boxDownsample(const QImage &image, int factor)
+{
+    if (image.isNull() || image.depth() != 32 || factor <= 1) {
+        return image;
+    }
+    
+    const int srcWidth = image.width();
+    const int srcHeight = image.height();
+    const int dstWidth = (srcWidth + factor - 1) / factor;
+    const int dstHeight = (srcHeight + factor - 1) / factor;
+    
+    QImage result(dstWidth, dstHeight, image.format());
+    if (result.isNull()) {
+        return result;
+    }
+    
+    const uchar *srcBits = image.constBits();
+    const qsizetype srcStride = image.bytesPerLine();
+    uchar *dstBits = result.bits();
+    const qsizetype dstStride = result.bytesPerLine();
+    
+    runStripes(dstHeight, StripeRows / factor + 1, [=](int firstRow, int lastRow) {
+        // Per-channel column sums for one output row; plain integer adds
+        // over contiguous memory, which the compiler vectorises
+        QVector<quint32> sums(dstWidth * 4);
+        for (int dy = firstRow; dy < lastRow; ++dy) {
+            std::fill(sums.begin(), sums.end(), 0u);
+            
+            const int firstSrcRow = dy * factor;
+            const int lastSrcRow = qMin(srcHeight, firstSrcRow + factor);
+            for (int sy = firstSrcRow; sy < lastSrcRow; ++sy) {
+                const uchar *px = srcBits + sy * srcStride;
+                quint32 *acc = sums.data();
+                int sx = 0;
+                for (int dx = 0; dx < dstWidth; ++dx, acc += 4) {
+                    const int blockEnd = qMin(srcWidth, sx + factor);
+                    for (; sx < blockEnd; ++sx, px += 4) {
+                        acc[0] += px[0];
+                        acc[1] += px[1];
+                        acc[2] += px[2];
+                        acc[3] += px[3];
+                    }
+                }
+            }
+            
+            const int rows = lastSrcRow - firstSrcRow;
+            uchar *out = dstBits + dy * dstStride;
+            for (int dx = 0; dx < dstWidth; ++dx) {
+                const int columns = qMin(factor, srcWidth - dx * factor);
+                const quint32 count = static_cast<quint32>(rows * columns);
+                const quint32 *acc = sums.constData() + dx * 4;
+                for (int c = 0; c < 4; ++c) {
+                    out[dx * 4 + c] = static_cast<uchar>((acc[c] + count / 2) / count);
+                }
+            }
+        }
+    });
+    
+    return result;
+}
+
+QImage ImageOps::resampled(const QImage &image, const QSize &size)
+{
+    if (image.isNull() || image.depth() != 32 || size.isEmpty()) {
+        return QImage();
+    }
+    if (size == image.size()) {
+        return image;
+    }
+    
+    QVector<qint16> columnWeights;
+    QVector<qint16> rowWeights;
+    const QVector<Contribution> columns = areaContributions(image.width(), size.width(),
+                                                            &columnWeights);
+    const QVector<Contribution> rows = areaContributions(image.height(), size.height(),
+                                                         &rowWeights);
+    
+    // Horizontal pass first, over every source row, so the vertical pass
+    // reads rows that are already output width
+    QImage horizontal(size.width(), image.height(), image.format());
+    QImage result(size, image.format());
+    if (horizontal.isNull() || result.isNull()) {
+        return QImage();
+    }
+    
+    const uchar *srcBits = image.constBits();
+    const qsizetype srcStride = image.bytesPerLine();
+    uchar *midBits = horizontal.bits();
+    const qsizetype midStride = horizontal.bytesPerLine();
+    uchar *dstBits = result.bits();
+    const qsizetype dstStride = result.bytesPerLine();
+    const int width = size.width();
+    const Contribution *columnData = columns.constData();
+    const qint16 *columnWeightData = columnWeights.constData();
+    const Contribution *rowData = rows.constData();
+    const qint16 *rowWeightData = rowWeights.constData();
+    
+    runStripes(image.height(), StripeRows, [=](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            resampleRow(reinterpret_cast<const quint32 *>(srcBits + y * srcStride),
+                        reinterpret_cast<quint32 *>(midBits + y * midStride),
+                        width, columnData, columnWeightData);
+        }
+    });
+    runStripes(size.height(), StripeRows, [=](int first, int last) {
+        for (int y = first; y < last; ++y) {
+            resampleColumn(midBits, midStride, reinterpret_cast<quint32 *>(dstBits + y * dstStride),
+                           width, rowData[y], rowWeightData);
+        }
+    });
+    
+    return result;
+}
+
+QImage ImageOps::downscaled(const QImage &image, const QSize &bounds)
+{
+    if (image.isNull() || bounds.isEmpty()) {
+        return QImage();
+    }
+    
+    QImage source = image;
+    if (source.depth() != 32) {
+        source = source.convertToFormat(source.hasAlphaChannel()
+                                        ? QImage::Format_ARGB32_Premultiplied
+                                        : QImage::Format_RGB32);
+    }
+    const QSize target = source.size().scaled(bounds, Qt::KeepAspectRatio)
+                             .boundedTo(source.size()).expandedTo(QSize(1, 1));
+    
+    // Large reductions box-average first: one streaming pass over the
+    // capture leaves an image at most about twice the target for the
+    // filter, so its cost no longer depends on the capture size
+    const int factor = qMin(source.width() / target.width(), source.height() / target.height());
+    if (factor >= 2) {
+        source = boxDownsample(source, factor);
+    }
+    return resampled(source, target);
+}
@@ -0,0 +1,46 @@
+#ifndef IMAGEOPS_H
+#define IMAGEOPS_H
+
+#include <QImage>
+#include <QVector>
+
+// Pixel kernels shared by the overlay and the capture pipeline. All of
+// them work on 32-bit images (RGB32 / ARGB32 / ARGB32_Premultiplied).
+class ImageOps
+{
+public:
+    // Same result as painting QColor(0, 0, 0, alpha) over the image, done
+    // once with a SIMD kernel instead of alpha-blending on every frame.
+    // The alpha channel is left untouched.
+    static QImage dimmed(const QImage &image, int alpha);
+
+    // A rect of image that points into image's own pixels instead of
+    // copying them, keeping the whole image alive until the last copy of
+    // the view is gone. Rows keep the source stride. The pixels are
+    // read-only; writing to the view detaches it into a private copy.
+    // A rect covering all of image returns image itself.
+    static QImage regionView(const QImage &image, const QRect &rect);
+
+    // Average each factor × factor block into one pixel. The result is
+    // ceil(width / factor) × ceil(height / factor); edge blocks average
+    // only the pixels they cover.
+    static QImage boxDownsample(const QImage &image, int factor);
+
+    // Area-averaged resize to exactly size, for reductions. Separable,
+    // with 14-bit fixed-point weights and SSE2 kernels that take two taps
+    // per multiply-add; both passes run in stripes on the thread pool.
+    static QImage resampled(const QImage &image, const QSize &size);
+
+    // Fit image inside bounds, keeping its aspect ratio and never
+    // enlarging. Reductions of 2× or more box-average down to near the
+    // target first, then resampled() finishes. Any format; the result is
+    // 32-bit.
+    static QImage downscaled(const QImage &image, const QSize &bounds);
+
+    // One 64-bit hash per tileSize × tileSize tile, row-major. Two images
+    // of the same size and format with equal hash vectors are treated as
+    // identical; tiles whose hashes differ have changed.
+    static QVector<quint64> tileHashes(const QImage &image, int tileSize = 64);
+};
+
+#endif // IMAGEOPS_H
@@ -0,0 +1,289 @@
+#include "instanceserver.h"
+#include "screencapture.h"
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSharedMemory>
+#include <QStandardPaths>
+#include <QUuid>
+#include <cstring>
+
+namespace {
+
+// A missing server fails at once; this only bounds a wedged one
+const int ConnectTimeoutMs = 500;
+// Grabbing a large desktop can take a while on the server
+const int ReplyTimeoutMs = 5000;
+// Requests are a few dozen bytes; anything longer without a newline is
+// not a client of ours and is cut off before it can grow the buffer
+const qint64 MaxRequestBytes = 64 * 1024;
+
+void writeMessage(QLocalSocket *socket, const QJsonObject &message)
+{
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+}
+
+bool connectToInstance(QLocalSocket *socket)
+{
+    socket->connectToServer(InstanceServer::serverName());
+    return socket->waitForConnected(ConnectTimeoutMs);
+}
+
+// Send one request and wait for its one-line answer
+bool exchange(QLocalSocket *socket, const QJsonObject &request, QJsonObject *reply,
+              QString *error)
+{
+    writeMessage(socket, request);
+    if (!socket->waitForBytesWritten(ReplyTimeoutMs)) {
+        if (error) {
+            *error = socket->errorString();
+        }
+        return false;
+    }
+    while (!socket->canReadLine()) {
+        if (!socket->waitForReadyRead(ReplyTimeoutMs)) {
+            if (error) {
+                *error = "No answer from the running Cordshot: " + socket->errorString();
+            }
+            return false;
+        }
+    }
+    *reply = QJsonDocument::fromJson(socket->readLine()).object();
+    return true;
+}
+
+} // namespace
+
+InstanceServer::InstanceServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+{
+    // Other users on the machine must not be able to drive the capture
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &InstanceServer::onNewConnection);
+}
+
+InstanceServer::~InstanceServer()
+{
+    qDeleteAll(m_segments);
+}
+
+bool InstanceServer::listen(QString *error)
+{
+    const QString name = serverName();
+    if (m_server->listen(name)) {
+        return true;
+    }
+    
+    // A socket file left behind by a crash: nobody answers on it
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError
+        && !InstanceClient::isRunning()) {
+        QLocalServer::removeServer(name);
+        if (m_server->listen(name)) {
+            return true;
+        }
+    }
+    if (error) {
+        *error = m_server->errorString();
+    }
+    return false;
+}
+
+QString InstanceServer::serverName()
+{
+#ifndef Q_OS_WIN
+    // A bare name would put the socket in the shared temp folder, where
+    // another user could create it first and answer in our place. The
+    // runtime folder (XDG_RUNTIME_DIR) is private to this user.
+    const QString runtime = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (!runtime.isEmpty()) {
+        return runtime + "/cordshot.sock";
+    }
+#endif
+    
+    // Windows, or no runtime folder: a name hashed from the user name
+    QString user = qEnvironmentVariable("USER");
+    if (user.isEmpty()) {
+        user = qEnvironmentVariable("USERNAME");
+    }
+    const QByteArray hash = QCryptographicHash::hash(user.toUtf8(), QCryptographicHash::Sha1);
+    return "cordshot-" + QString::fromLatin1(hash.toHex().left(12));
+}
+
+void InstanceServer::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        // Stop reading from a client that never ends its line
+        socket->setReadBufferSize(MaxRequestBytes);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            // The client is done with the pixels
+            delete m_segments.take(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void InstanceServer::onReadyRead(QLocalSocket *socket)
+{
+    while (socket->canReadLine()) {
+        const QJsonObject request = QJsonDocument::fromJson(socket->readLine()).object();
+        const QString command = request["command"].toString();
+        
+        QJsonObject reply;
+        if (command == "grab") {
+            reply = grab(socket, request);
+        } else if (command == "show" || command == "capture") {
+            reply["ok"] = true;
+            // Queued: the client should not wait on a capture starting
+            QMetaObject::invokeMethod(this, [this, command]() {
+                emit commandReceived(command);
+            }, Qt::QueuedConnection);
+        } else {
+            reply["ok"] = false;
+            reply["error"] = "Unknown command: " + command;
+        }
+        writeMessage(socket, reply);
+    }
+    
+    // A full buffer without a newline is not a request; drop the client
+    if (socket->bytesAvailable() >= MaxRequestBytes) {
+        delete m_segments.take(socket);
+        socket->abort();
+        socket->deleteLater();
+    }
+}
+
+QJsonObject InstanceServer::grab(QLocalSocket *socket, const QJsonObject &request)
+{
+    QJsonObject reply;
+    reply["ok"] = false;
+    
+    QRect region;
+    const QJsonArray values = request["region"].toArray();
+    if (values.size() == 4) {
+        region = QRect(values[0].toInt(), values[1].toInt(), values[2].toInt(), values[3].toInt());
+    }
+    
+    QString error;
+    const QImage image = ScreenCapture::grabRegion(region, request["screen"].toInt(-1), &error);
+    if (image.isNull()) {
+        reply["error"] = error;
+        return reply;
+    }
+    
+    // Segments only grow, so repeated grabs on one connection reuse theirs
+    const qint64 lineBytes = (qint64(image.width()) * image.depth() + 7) / 8;
+    const qint64 stride = (qint64(image.width()) * image.depth() + 31) / 32 * 4;
+    const qint64 bytes = stride * image.height();
+    QSharedMemory *&memory = m_segments[socket];
+    if (!memory || memory->size() < bytes) {
+        delete memory;
+        memory = new QSharedMemory("cordshot-grab-" + QUuid::createUuid().toString(QUuid::WithoutBraces));
+        if (!memory->create(int(bytes))) {
+            reply["error"] = memory->errorString();
+            delete memory;
+            memory = nullptr;
+            return reply;
+        }
+    }
+    
+    memory->lock();
+    uchar *target = static_cast<uchar *>(memory->data());
+    for (int y = 0; y < image.height(); ++y) {
+        std::memcpy(target + y * stride, image.constScanLine(y), lineBytes);
+    }
+    memory->unlock();
+    
+    reply["ok"] = true;
+    reply["key"] = memory->key();
+    reply["width"] = image.width();
+    reply["height"] = image.height();
+    reply["stride"] = int(stride);
+    reply["format"] = int(image.format());
+    reply["devicePixelRatio"] = image.devicePixelRatio();
+    return reply;
+}
+
+bool InstanceClient::isRunning()
+{
+    QLocalSocket socket;
+    return connectToInstance(&socket);
+}
+
+bool InstanceClient::send(const QString &command)
+{
+    QLocalSocket socket;
+    if (!connectToInstance(&socket)) {
+        return false;
+    }
+    
+    QJsonObject request;
+    request["command"] = command;
+    QJsonObject reply;
+    return exchange(&socket, request, &reply, nullptr) && reply["ok"].toBool();
+}
+
+QImage InstanceClient::grab(const QRect &region, int screenIndex, QString *error)
+{
+    QLocalSocket socket;
+    if (!connectToInstance(&socket)) {
+        if (error) {
+            *error = "Cordshot is not running";
+        }
+        return QImage();
+    }
+    
+    QJsonObject request;
+    request["command"] = "grab";
+    if (!region.isNull()) {
+        request["region"] = QJsonArray{region.x(), region.y(), region.width(), region.height()};
+    }
+    request["screen"] = screenIndex;
+    
+    QJsonObject reply;
+    if (!exchange(&socket, request, &reply, error)) {
+        return QImage();
+    }
+    if (!reply["ok"].toBool()) {
+        if (error) {
+            *error = reply["error"].toString();
+        }
+        return QImage();
+    }
+    
+    // Attached while the connection keeps the segment alive
+    QSharedMemory memory(reply["key"].toString());
+    const int width = reply["width"].toInt();
+    const int height = reply["height"].toInt();
+    const qint64 stride = reply["stride"].toInt();
+    QImage image(width, height, QImage::Format(reply["format"].toInt()));
+    if (!memory.attach(QSharedMemory::ReadOnly) || image.isNull()
+        || memory.size() < stride * height) {
+        if (error) {
+            *error = image.isNull() ? QString("Not enough memory for the capture")
+                                    : memory.errorString();
+        }
+        return QImage();
+    }
+    
+    memory.lock();
+    const uchar *source = static_cast<const uchar *>(memory.constData());
+    if (image.bytesPerLine() == stride) {
+        std::memcpy(image.bits(), source, stride * height);
+    } else {
+        const qint64 lineBytes = qMin<qint64>(stride, image.bytesPerLine());
+        for (int y = 0; y < height; ++y) {
+            std::memcpy(image.scanLine(y), source + y * stride, lineBytes);
+        }
+    }
+    memory.unlock();
+    memory.detach();
+    
+    image.setDevicePixelRatio(reply["devicePixelRatio"].toDouble(1.0));
+    return image;
+}
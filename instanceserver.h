@@ -0,0 +1,72 @@
+#ifndef INSTANCESERVER_H
+#define INSTANCESERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QJsonObject>
+#include <QRect>
+#include <QString>
+
+class QLocalServer;
+class QLocalSocket;
+class QSharedMemory;
+
+// Local socket the tray instance listens on, so a second launch can hand
+// over its command and exit instead of starting another app. Messages
+// are one compact JSON object per line, each answered with one line; a
+// client that sends 64 KiB without a newline is disconnected:
+//
+//   {"command":"show"}      raise the main window
+//   {"command":"capture"}   start an interactive capture
+//   {"command":"grab","region":[x,y,w,h],"screen":N}
+//
+// A grab answers with the key of a QSharedMemory segment holding the raw
+// scanlines, plus width, height, stride and format, so the pixels cross
+// over without an encode. The segment stays valid until the connection
+// closes and is reused for further grabs on it.
+class InstanceServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InstanceServer(QObject *parent = nullptr);
+    ~InstanceServer();
+
+    // Fails when another instance already listens
+    bool listen(QString *error = nullptr);
+
+    // Per user, so sessions sharing a machine keep their own instance. A
+    // full path in the user's runtime folder on Unix; a name hashed from
+    // the user name on Windows, or where there is no runtime folder.
+    static QString serverName();
+
+signals:
+    // "show" or "capture", delivered after the client has its answer
+    void commandReceived(const QString &command);
+
+private slots:
+    void onNewConnection();
+
+private:
+    void onReadyRead(QLocalSocket *socket);
+    QJsonObject grab(QLocalSocket *socket, const QJsonObject &request);
+
+    QLocalServer *m_server;
+    QHash<QLocalSocket *, QSharedMemory *> m_segments;
+};
+
+// The other end, used by later launches and headless captures. Blocking;
+// every call opens its own connection.
+class InstanceClient
+{
+public:
+    static bool isRunning();
+    // True once the running instance accepted the command
+    static bool send(const QString &command);
+    // Same arguments as ScreenCapture::grabRegion(), grabbed by the
+    // running instance and copied out of its shared memory segment
+    static QImage grab(const QRect &region, int screenIndex, QString *error = nullptr);
+};
+
+#endif // INSTANCESERVER_H
@@ -0,0 +1,454 @@
+#include "intervalcapture.h"
+#include "screencapture.h"
+#include "imageops.h"
+#include <QDateTime>
+#include <QCoreApplication>
+#include <QDir>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+namespace {
+
+const qint64 NsPerMs = 1000000;
+
+} // namespace
+
+QString IntervalCaptureStats::summary() const
+{
+    QString text = QString("%1 frames in %2 s • %3 fps")
+                   .arg(captured)
+                   .arg(elapsedMs / 1000.0, 0, 'f', 1)
+                   .arg(achievedFps, 0, 'f', 1);
+    if (requestedFps > 0.0) {
+        text += QString(" of %1").arg(requestedFps, 0, 'f', 1);
+    }
+    if (duplicates > 0) {
+        const quint64 grabbed = captured + dropped + duplicates;
+        text += QString(" • %1% unchanged, ~%2 s encode saved")
+                .arg(duplicates * 100 / qMax<quint64>(1, grabbed))
+                .arg(savedMs / 1000.0, 0, 'f', 1);
+    }
+    if (dropped > 0 || missed > 0) {
+        text += QString(" • %1 dropped, %2 missed").arg(dropped).arg(missed);
+    }
+    if (grabFailed > 0) {
+        text += QString(" • %1 grabs failed").arg(grabFailed);
+    }
+    if (failed > 0) {
+        text += QString(" • %1 failed").arg(failed);
+    }
+    return text;
+}
+
+IntervalCapture::IntervalCapture(const IntervalCaptureSettings &settings, QObject *parent)
+    : QObject(parent)
+    , m_settings(settings)
+    , m_ring(settings.ringCapacity, settings.ringBytes)
+    , m_tickTimer(new QTimer(this))
+    , m_progressTimer(new QTimer(this))
+    , m_encoderPool(new QThreadPool(this))
+    , m_nextTickNs(0)
+    , m_stopNs(0)
+    , m_sequence(0)
+    , m_captured(0)
+    , m_dropped(0)
+    , m_missed(0)
+    , m_duplicates(0)
+    , m_grabFailed(0)
+    , m_hashNs(0)
+    , m_encoded(0)
+    , m_failed(0)
+    , m_encodeNs(0)
+    , m_activeEncoders(0)
+    , m_running(false)
+    , m_stopping(false)
+    , m_previousSequence(0)
+{
+    m_tickTimer->setSingleShot(true);
+    m_tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_tickTimer, &QTimer::timeout, this, &IntervalCapture::captureTick);
+    
+    m_progressTimer->setInterval(1000);
+    connect(m_progressTimer, &QTimer::timeout, this, [this]() {
+        emit progress(stats());
+    });
+    
+    // Leave one core for grabbing on the GUI thread
+    m_encoderPool->setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, 8));
+}
+
+IntervalCapture::~IntervalCapture()
+{
+    m_tickTimer->stop();
+    closeQueue();
+    // Spooled images point into the mapping, which goes with m_spool
+    m_encoderPool->waitForDone();
+}
+
+bool IntervalCapture::start(QString *error)
+{
+    if (m_running) {
+        return true;
+    }
+    
+    if (!QDir().mkpath(m_settings.outputDir)) {
+        if (error) {
+            *error = "Cannot create folder " + m_settings.outputDir;
+        }
+        return false;
+    }
+    
+    m_manifest.setFileName(QDir(m_settings.outputDir).filePath("frames.csv"));
+    if (!m_manifest.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) {
+            *error = "Cannot write " + m_manifest.fileName();
+        }
+        return false;
+    }
+    m_manifest.write("sequence,timestamp_us,wall_clock,file\n");
+    
+    if (m_settings.spoolBytes > 0) {
+        FrameSpool::Metadata metadata;
+        metadata.outputDir = m_settings.outputDir;
+        metadata.format = m_settings.format;
+        metadata.presetKey = ImageEncoder::key(m_settings.preset);
+        metadata.framesPerFolder = m_settings.framesPerFolder;
+        
+        // One file per session; the pid keeps two instances apart
+        const QString path = QDir(FrameSpool::directory()).filePath(
+            QString("interval_%1_%2.spool")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz"))
+            .arg(QCoreApplication::applicationPid()));
+        m_spool.reset(new FrameSpool);
+        if (!m_spool->create(path, m_settings.spoolBytes, metadata, error)) {
+            m_spool.reset();
+            m_manifest.close();
+            return false;
+        }
+    }
+    
+    m_running = true;
+    m_clock.start();
+    m_nextTickNs = 0;
+    
+    startEncoders();
+    m_progressTimer->start();
+    captureTick();
+    return true;
+}
+
+bool IntervalCapture::resume(const QString &spoolPath, QString *error)
+{
+    if (m_running) {
+        return false;
+    }
+    
+    m_spool.reset(new FrameSpool);
+    if (!m_spool->recover(spoolPath, error)) {
+        m_spool.reset();
+        return false;
+    }
+    
+    const FrameSpool::Metadata metadata = m_spool->metadata();
+    m_settings.outputDir = metadata.outputDir;
+    m_settings.format = metadata.format;
+    m_settings.preset = ImageEncoder::fromKey(metadata.presetKey);
+    m_settings.framesPerFolder = metadata.framesPerFolder;
+    m_settings.intervalMs = 0;
+    // Spooled frames were already deduplicated when they were grabbed
+    m_settings.dedup = IntervalCaptureSettings::DedupOff;
+    
+    // Earlier frames are already listed; carry on after them
+    m_manifest.setFileName(QDir(m_settings.outputDir).filePath("frames.csv"));
+    const bool exists = m_manifest.exists();
+    if (!QDir().mkpath(m_settings.outputDir)
+        || !m_manifest.open(QIODevice::Append | QIODevice::Text)) {
+        if (error) {
+            *error = "Cannot write " + m_manifest.fileName();
+        }
+        m_spool.reset();
+        return false;
+    }
+    if (!exists) {
+        m_manifest.write("sequence,timestamp_us,wall_clock,file\n");
+    }
+    
+    // Nothing more to grab: drain and finish
+    m_running = true;
+    m_stopping = true;
+    m_clock.start();
+    m_captured = m_spool->recoveredCount();
+    m_spool->close();
+    
+    startEncoders();
+    m_progressTimer->start();
+    return true;
+}
+
+void IntervalCapture::stop()
+{
+    if (!m_running || m_stopping) {
+        return;
+    }
+    
+    m_stopping = true;
+    m_stopNs = m_clock.nsecsElapsed();
+    m_tickTimer->stop();
+    
+    // Encoders drain what is queued, then exit and report back
+    closeQueue();
+}
+
+bool IntervalCapture::isRunning() const
+{
+    return m_running;
+}
+
+IntervalCaptureStats IntervalCapture::stats() const
+{
+    IntervalCaptureStats result;
+    result.captured = m_captured;
+    result.dropped = m_dropped;
+    result.missed = m_missed;
+    result.grabFailed = m_grabFailed;
+    result.duplicates = m_duplicates;
+    result.encoded = m_encoded.load();
+    result.failed = m_failed.load();
+    result.ringHighWater = m_spool ? m_spool->highWater() : m_ring.highWater();
+    
+    // Rates cover the grabbing period only, not the final drain
+    const qint64 elapsedNs = m_stopping ? m_stopNs : m_clock.nsecsElapsed();
+    result.elapsedMs = elapsedNs / NsPerMs;
+    if (elapsedNs > 0) {
+        result.achievedFps = (m_captured + m_dropped + m_duplicates) * 1e9 / elapsedNs;
+    }
+    
+    const quint64 grabbed = m_captured + m_dropped + m_duplicates;
+    if (grabbed > 0 && m_settings.dedup != IntervalCaptureSettings::DedupOff) {
+        result.hashMsPerFrame = m_hashNs / 1e6 / grabbed;
+    }
+    if (result.encoded > 0) {
+        result.encodeMsPerFrame = m_encodeNs.load() / 1e6 / result.encoded;
+        result.savedMs = static_cast<qint64>(result.encodeMsPerFrame * m_duplicates);
+    }
+    if (m_settings.intervalMs > 0) {
+        result.requestedFps = 1000.0 / m_settings.intervalMs;
+    }
+    return result;
+}
+
+void IntervalCapture::captureTick()
+{
+    if (m_stopping) {
+        return;
+    }
+    
+    TimedFrame frame;
+    frame.sequence = ++m_sequence;
+    frame.timestampNs = m_clock.nsecsElapsed();
+    frame.wallClockMs = QDateTime::currentMSecsSinceEpoch();
+    
+    // Same grab and crop path as the command-line capture
+    frame.image = ScreenCapture::grabRegion(m_settings.region, m_settings.screenIndex);
+    
+    if (frame.image.isNull()) {
+        ++m_grabFailed;
+    } else {
+        QVector<quint64> hashes;
+        if (isDuplicate(frame, &hashes)) {
+            ++m_duplicates;
+            if (m_settings.dedup == IntervalCaptureSettings::DedupReference) {
+                referencePrevious(std::move(frame));
+            }
+        } else {
+            const quint64 sequence = frame.sequence;
+            const QSize size = frame.image.size();
+            if (pushFrame(std::move(frame))) {
+                ++m_captured;
+                // Only frames that will really be written can be referenced
+                m_previousHashes = hashes;
+                m_previousSize = size;
+                
+                QMutexLocker locker(&m_manifestMutex);
+                m_frameWritten.remove(m_previousSequence);
+                m_previousSequence = sequence;
+            } else {
+                ++m_dropped;
+            }
+        }
+    }
+    
+    if (m_settings.frameLimit > 0 && m_sequence >= static_cast<quint64>(m_settings.frameLimit)) {
+        stop();
+        return;
+    }
+    
+    // Schedule against absolute deadlines so timer jitter does not
+    // accumulate; deadlines that have already passed are skipped
+    const qint64 intervalNs = qMax(1, m_settings.intervalMs) * NsPerMs;
+    m_nextTickNs += intervalNs;
+    const qint64 now = m_clock.nsecsElapsed();
+    if (now > m_nextTickNs) {
+        const qint64 late = (now - m_nextTickNs) / intervalNs + 1;
+        m_missed += late;
+        m_nextTickNs += late * intervalNs;
+    }
+    m_tickTimer->start(static_cast<int>((m_nextTickNs - now) / NsPerMs));
+}
+
+bool IntervalCapture::isDuplicate(const TimedFrame &frame, QVector<quint64> *hashes)
+{
+    if (m_settings.dedup == IntervalCaptureSettings::DedupOff) {
+        return false;
+    }
+    
+    QElapsedTimer hashTimer;
+    hashTimer.start();
+    *hashes = ImageOps::tileHashes(frame.image);
+    m_hashNs += hashTimer.nsecsElapsed();
+    
+    return m_previousSequence > 0 && frame.image.size() == m_previousSize &&
+           *hashes == m_previousHashes;
+}
+
+QString IntervalCapture::frameFileName(quint64 sequence) const
+{
+    const QString fileName = QString("frame_%1.%2")
+                             .arg(sequence, 6, 10, QChar('0'))
+                             .arg(QString::fromLatin1(m_settings.format));
+    if (m_settings.framesPerFolder <= 0) {
+        return fileName;
+    }
+    
+    // Relative to outputDir, which is also how frames.csv lists it
+    return QString("%1/%2")
+           .arg((sequence - 1) / m_settings.framesPerFolder, 4, 10, QChar('0'))
+           .arg(fileName);
+}
+
+void IntervalCapture::startEncoders()
+{
+    // Encoders block on the queue until frames arrive or it is closed
+    m_activeEncoders = m_encoderPool->maxThreadCount();
+    for (int i = 0; i < m_activeEncoders; ++i) {
+        m_encoderPool->start([this]() { encoderLoop(); });
+    }
+}
+
+bool IntervalCapture::pushFrame(TimedFrame frame)
+{
+    if (m_spool) {
+        return m_spool->tryPush(frame, m_settings.region);
+    }
+    return m_ring.tryPush(std::move(frame));
+}
+
+bool IntervalCapture::popFrame(TimedFrame *frame)
+{
+    return m_spool ? m_spool->pop(frame) : m_ring.pop(frame);
+}
+
+void IntervalCapture::closeQueue()
+{
+    if (m_spool) {
+        m_spool->close();
+    }
+    m_ring.close();
+}
+
+void IntervalCapture::encoderLoop()
+{
+    const QDir outputDir(m_settings.outputDir);
+    CaptureFileWriter::Options options;
+    options.sync = m_settings.sync;
+    TimedFrame frame;
+    while (popFrame(&frame)) {
+        const QString fileName = frameFileName(frame.sequence);
+        
+        const EncodeResult result = ImageEncoder::write(frame.image, outputDir.filePath(fileName),
+                                                        m_settings.preset, options);
+        if (result.ok) {
+            m_encodeNs += (result.encodeUs + result.writeUs) * 1000;
+            ++m_encoded;
+        } else {
+            ++m_failed;
+        }
+        frameFinished(frame, fileName, result.ok);
+        
+        // Release the pixels, or the spool space, before blocking on the
+        // next frame
+        frame = TimedFrame();
+    }
+    
+    QMetaObject::invokeMethod(this, [this]() { encoderExited(); }, Qt::QueuedConnection);
+}
+
+void IntervalCapture::encoderExited()
+{
+    if (--m_activeEncoders > 0) {
+        return;
+    }
+    
+    m_progressTimer->stop();
+    m_manifest.close();
+    m_running = false;
+    emit finished(stats());
+    
+    // Every frame is encoded; this deletes the spool file
+    m_spool.reset();
+}
+
+void IntervalCapture::referencePrevious(TimedFrame frame)
+{
+    // Only the timestamps are listed
+    frame.image = QImage();
+    
+    QMutexLocker locker(&m_manifestMutex);
+    const auto outcome = m_frameWritten.constFind(m_previousSequence);
+    if (outcome == m_frameWritten.constEnd()) {
+        // Still being encoded; frameFinished() lists it
+        m_waitingReferences[m_previousSequence].append(frame);
+    } else if (outcome.value()) {
+        locker.unlock();
+        writeManifestLine(frame, frameFileName(m_previousSequence));
+    }
+    // A frame that failed to write has no file to point at
+}
+
+void IntervalCapture::frameFinished(const TimedFrame &frame, const QString &fileName, bool written)
+{
+    QVector<TimedFrame> references;
+    {
+        QMutexLocker locker(&m_manifestMutex);
+        references = m_waitingReferences.take(frame.sequence);
+        // Older frames can no longer be referenced. A newer one may finish
+        // before captureTick() makes it the previous frame.
+        if (m_settings.dedup == IntervalCaptureSettings::DedupReference
+            && frame.sequence >= m_previousSequence) {
+            m_frameWritten.insert(frame.sequence, written);
+        }
+    }
+    if (!written) {
+        return;
+    }
+    
+    writeManifestLine(frame, fileName);
+    for (const TimedFrame &reference : references) {
+        writeManifestLine(reference, fileName);
+    }
+}
+
+void IntervalCapture::writeManifestLine(const TimedFrame &frame, const QString &fileName)
+{
+    const QString line = QString("%1,%2,%3,%4\n")
+                         .arg(frame.sequence)
+                         .arg(frame.timestampNs / 1000)
+                         .arg(QDateTime::fromMSecsSinceEpoch(frame.wallClockMs)
+                              .toString(Qt::ISODateWithMs))
+                         .arg(fileName);
+    
+    QMutexLocker locker(&m_manifestMutex);
+    m_manifest.write(line.toUtf8());
+}
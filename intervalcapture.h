@@ -0,0 +1,151 @@
+#ifndef INTERVALCAPTURE_H
+#define INTERVALCAPTURE_H
+
+#include "framering.h"
+#include "framespool.h"
+#include "imageencoder.h"
+#include <QObject>
+#include <QRect>
+#include <QString>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QScopedPointer>
+#include <atomic>
+
+class QTimer;
+class QThreadPool;
+
+struct IntervalCaptureSettings
+{
+    enum DedupMode {
+        DedupOff,           // Encode every frame
+        DedupSkip,          // Skip frames identical to the previous one
+        DedupReference      // Skip them, but list them in frames.csv
+                            // against the previous frame's file once it
+                            // is written
+    };
+
+    QRect region;              // Logical virtual-desktop coordinates
+    int screenIndex = -1;      // Or relative to this screen
+    int intervalMs = 1000;
+    int frameLimit = 0;        // Stop after this many frames; 0 = until stop()
+    int ringCapacity = 64;     // Frames waiting for an encoder
+    qint64 ringBytes = 256 * 1024 * 1024;
+    qint64 spoolBytes = 0;     // Queue frames in a FrameSpool of this size
+                               // instead of the ring; 0 = in memory
+    QString outputDir;
+    QByteArray format = "png";
+    ImageEncoder::Preset preset = ImageEncoder::FastPng;  // Applies when format matches it
+    DedupMode dedup = DedupReference;
+    int framesPerFolder = 0;   // Split frames into numbered subfolders; 0 = all in outputDir
+    CaptureFileWriter::SyncPolicy sync = CaptureFileWriter::NoSync;
+};
+
+struct IntervalCaptureStats
+{
+    quint64 captured = 0;      // Grabbed and queued for encoding
+    quint64 dropped = 0;       // Grabbed but refused by the full ring
+    quint64 missed = 0;        // Ticks skipped because a grab overran
+    quint64 grabFailed = 0;    // Ticks whose grab returned no image
+    quint64 duplicates = 0;    // Identical to the previous frame, not encoded
+    quint64 encoded = 0;
+    quint64 failed = 0;
+    int ringHighWater = 0;
+    qint64 elapsedMs = 0;
+    double requestedFps = 0.0;
+    double achievedFps = 0.0;
+    double hashMsPerFrame = 0.0;
+    double encodeMsPerFrame = 0.0;
+    qint64 savedMs = 0;        // Estimated encode time avoided by dedup
+
+    QString summary() const;
+};
+
+// Captures a fixed region every intervalMs. Frames are timestamped into a
+// bounded FrameRing and encoded by a pool of background workers; when the
+// encoders fall behind, new frames are dropped rather than queued without
+// limit. Frames whose tile hashes match the previous frame are not encoded
+// again. Every frame is listed in frames.csv in the output folder.
+//
+// With spoolBytes set, the queue is a memory-mapped FrameSpool on disk
+// instead: bursts larger than RAM are absorbed, and frames left over by a
+// crash are encoded by resume() on the next run.
+class IntervalCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit IntervalCapture(const IntervalCaptureSettings &settings, QObject *parent = nullptr);
+    ~IntervalCapture();
+
+    bool start(QString *error = nullptr);
+    // Encode the frames left in an abandoned spool (FrameSpool::abandoned())
+    // into the folder it was writing to, then finish as after stop()
+    bool resume(const QString &spoolPath, QString *error = nullptr);
+    // Stop grabbing; queued frames are still encoded before finished()
+    void stop();
+    bool isRunning() const;
+
+    IntervalCaptureStats stats() const;
+
+signals:
+    void progress(const IntervalCaptureStats &stats);
+    void finished(const IntervalCaptureStats &stats);
+
+private slots:
+    void captureTick();
+
+private:
+    void startEncoders();
+    bool pushFrame(TimedFrame frame);
+    bool popFrame(TimedFrame *frame);
+    void closeQueue();
+    void encoderLoop();
+    void encoderExited();
+    bool isDuplicate(const TimedFrame &frame, QVector<quint64> *hashes);
+    QString frameFileName(quint64 sequence) const;
+    void writeManifestLine(const TimedFrame &frame, const QString &fileName);
+    void referencePrevious(TimedFrame frame);
+    void frameFinished(const TimedFrame &frame, const QString &fileName, bool written);
+
+    IntervalCaptureSettings m_settings;
+    FrameRing m_ring;
+    QScopedPointer<FrameSpool> m_spool;
+    QTimer *m_tickTimer;
+    QTimer *m_progressTimer;
+    QThreadPool *m_encoderPool;
+    QElapsedTimer m_clock;
+    qint64 m_nextTickNs;
+    qint64 m_stopNs;
+    quint64 m_sequence;
+    quint64 m_captured;
+    quint64 m_dropped;
+    quint64 m_missed;
+    quint64 m_duplicates;
+    quint64 m_grabFailed;
+    qint64 m_hashNs;
+    std::atomic<quint64> m_encoded;
+    std::atomic<quint64> m_failed;
+    std::atomic<qint64> m_encodeNs;
+    int m_activeEncoders;
+    bool m_running;
+    bool m_stopping;
+
+    // Last frame handed to the encoders, for deduplication. The sequence
+    // is only changed under m_manifestMutex, which encoders read it under.
+    QVector<quint64> m_previousHashes;
+    QSize m_previousSize;
+    quint64 m_previousSequence;
+
+    QMutex m_manifestMutex;
+    QFile m_manifest;
+    // A duplicate is listed against its frame's file only once that file
+    // is written. Outcomes of frames that can still be referenced, and
+    // duplicates waiting for theirs, by frame sequence.
+    QHash<quint64, bool> m_frameWritten;
+    QHash<quint64, QVector<TimedFrame>> m_waitingReferences;
+};
+
+#endif // INTERVALCAPTURE_H
@@ -1,22 +1,72 @@
 #include "mainwindow.h"
+#include "headlesscapture.h"
+#include "instanceserver.h"
+#include "appstyle.h"
+#include "startupprofile.h"
 
 #include <QApplication>
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    // Started first so command-line captures can report cold-start time
+    QElapsedTimer startTimer;
+    startTimer.start();
+    StartupProfile::start(startTimer);
     
     // Set application info
-    QApplication::setApplicationName("Cordshot");
-    QApplication::setOrganizationName("Cordshot");
-    QApplication::setApplicationVersion("1.1.0");
+    QCoreApplication::setApplicationName("Cordshot");
+    QCoreApplication::setOrganizationName("Cordshot");
+    QCoreApplication::setApplicationVersion("1.1.0");
     
-    // Enable high DPI scaling
-    QApplication::setHighDpiScaleFactorRoundingPolicy(
+    // Enable high DPI scaling (must be set before the application object)
+    QGuiApplication::setHighDpiScaleFactorRoundingPolicy(
         Qt::HighDpiScaleFactorRoundingPolicy::PassThrough);
     
+    // Command-line capture: no widgets, no tray icon, just grab and exit
+    if (HeadlessCapture::isRequested(argc, argv)) {
+        QGuiApplication app(argc, argv);
+        return HeadlessCapture::run(app.arguments(), startTimer);
+    }
+    
+    // --capture starts a capture right away instead of showing the window;
+    // --startup-profile prints how long each startup step took
+    QString command = "show";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--capture") == 0) {
+            command = "capture";
+        } else if (std::strcmp(argv[i], "--startup-profile") == 0) {
+            StartupProfile::setReporting(true);
+        }
+    }
+    
+    // One tray instance per user: later launches hand it their command
+    // and exit before paying for any widgets. The probe only needs the
+    // event dispatcher QLocalSocket relies on.
+    {
+        QCoreApplication probe(argc, argv);
+        if (InstanceClient::send(command)) {
+            return 0;
+        }
+    }
+    
+    QApplication a(argc, argv);
+    // Styles every widget as it is created, parsed once
+    AppStyle::apply(&a);
+    StartupProfile::mark("application");
+    
     MainWindow w;
-    w.show();
+    StartupProfile::mark("main window");
+    if (command == "capture") {
+        w.runCommand(command);
+        // No first paint to wait for
+        QTimer::singleShot(0, []() { StartupProfile::report(); });
+    } else {
+        w.show();
+    }
     
     return a.exec();
 }
@@ -7,8 +7,21 @@
 #include <QVBoxLayout>
 #include <QSystemTrayIcon>
 #include <QSettings>
+#include <QHash>
+#include <QPointer>
+#include "screenshotoverlay.h"
+#include "intervalcapture.h"
+#include "regionwatcher.h"
+#include "imageencoder.h"
 
-class ScreenshotOverlay;
+class SaveQueue;
+class CaptureHistory;
+class CaptureGallery;
+class Downscaler;
+class InstanceServer;
+class QAction;
+class QComboBox;
+class QTimer;
 
 class MainWindow : public QMainWindow
 {
@@ -19,25 +32,67 @@ public:
     ~MainWindow();
     
     QString getSavePath() const;
+    // "show" or "capture", from the command line or a later launch
+    void runCommand(const QString &command);
 
 protected:
+    void paintEvent(QPaintEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private slots:
     void startScreenshot();
-    void onScreenshotTaken(const QPixmap &screenshot, const QString &savedPath);
+    void onScreenshotTaken(const QImage &screenshot, const QString &savePath,
+                           const SharedEncodedImage &encoded);
+    void onPreviewScaled(int id, const QImage &preview);
+    void onScreenshotSaved(int id, const EncodeResult &result);
+    void onScreenshotSaveFailed(int id, const EncodeResult &result);
+    void onEncoderPresetChanged(int index);
     void onScreenshotCancelled();
+    void onOverlayReady();
+    void exportCaptureTrace();
+    void onRegionSelected(const QRect &region);
+    void toggleIntervalCapture();
+    void onIntervalProgress(const IntervalCaptureStats &stats);
+    void onIntervalFinished(const IntervalCaptureStats &stats);
+    void resumeAbandonedSpools();
+    void toggleRegionWatch();
+    void onWatchedRegionChanged(const QRect &changedArea, const QImage &frame,
+                                const QString &filePath);
+    void onWatchFinished(const RegionWatchStats &stats);
     void trayIconActivated(QSystemTrayIcon::ActivationReason reason);
     void selectSaveFolder();
     void openScreenshotLocation();
     void openCoordinatePicker();
+    void openPickerForCapture(int captureId);
+    void onCaptureImageReady(int captureId, const QImage &image);
+    void onCaptureImageFailed(int captureId, const QString &error);
+    void showCaptureHistory();
 
 private:
+    // What a region picked in RegionMode is used for
+    enum RegionTask {
+        IntervalTask,
+        WatchTask
+    };
+
     void setupUI();
     void setupTrayIcon();
+    // Built when first needed rather than in the constructor
+    void ensureResultButtons();
+    void ensureOverlay();
+    void addCaptureButtonShadow();
     void loadSettings();
     void saveSettings();
     void updateSavePathDisplay();
+    void beginCapture(ScreenshotOverlay::Mode mode);
+    void armOverlay();
+    // Stop waiting for the main window to unmap before a capture
+    void finishArmPending();
+    QString captureStatsText() const;
+    void startIntervalCapture(const QRect &region);
+    void startRegionWatch(const QRect &region);
+    void showCoordinatePicker(int captureId, const QImage &image);
 
     QPushButton *m_captureButton;
     QPushButton *m_folderButton;
@@ -46,12 +101,34 @@ private:
     QLabel *m_statusLabel;
     QLabel *m_previewLabel;
     QLabel *m_savePathLabel;
+    QComboBox *m_encoderCombo;
+    QVBoxLayout *m_mainLayout;
     ScreenshotOverlay *m_overlay;
     QSystemTrayIcon *m_trayIcon;
-    QPixmap m_lastScreenshot;
     QString m_savePath;
+    ImageEncoder::Preset m_encoderPreset;
     QString m_lastSavedPath;
     QSettings *m_settings;
+    int m_traceId;
+    bool m_armPending;
+    QTimer *m_armTimer;
+    SaveQueue *m_saveQueue;
+    int m_lastSaveId;
+    ScreenshotOverlay::Mode m_overlayMode;
+    IntervalCapture *m_intervalCapture;
+    QAction *m_intervalAction;
+    RegionTask m_regionTask;
+    RegionWatcher *m_regionWatcher;
+    QAction *m_watchAction;
+    CaptureHistory *m_history;
+    int m_lastCaptureId;
+    int m_pendingPickerId;         // Capture being reloaded for the picker
+    QHash<int, int> m_saveCaptures; // Save queue id -> capture id
+    QPointer<CaptureGallery> m_gallery;
+    Downscaler *m_downscaler;
+    int m_previewRequestId;
+    InstanceServer *m_instanceServer;
+    bool m_firstPaintDone;
 };
 
 #endif // MAINWINDOW_H
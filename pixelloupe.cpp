@@ -0,0 +1,185 @@
+#include "pixelloupe.h"
+#include <QPainter>
+
+namespace {
+
+// Odd, so the pixel under the cursor has a centre cell
+const int Cells = 15;
+const int CellSize = 9;
+const int GridSize = Cells * CellSize;
+const int TextHeight = 38;
+
+// Distance from the cursor, so the loupe never hides what it magnifies
+const int CursorGap = 24;
+
+QFont loupeFont()
+{
+    QFont font("Consolas");
+    font.setStyleHint(QFont::Monospace);
+    font.setPointSize(9);
+    return font;
+}
+
+} // namespace
+
+PixelLoupe::PixelLoupe()
+    : m_premultiplied(false)
+    , m_visible(false)
+    , m_font(loupeFont())
+    , m_metrics(m_font)
+{
+}
+
+void PixelLoupe::setImage(const QImage &image)
+{
+    m_image = image;
+    // Pixels are read as QRgb; other 32-bit formats (RGBA8888, RGB30)
+    // order or pack their channels differently
+    const QImage::Format format = m_image.format();
+    if (!m_image.isNull() && format != QImage::Format_RGB32 && format != QImage::Format_ARGB32
+        && format != QImage::Format_ARGB32_Premultiplied) {
+        m_image = m_image.convertToFormat(m_image.hasAlphaChannel() ? QImage::Format_ARGB32
+                                                                    : QImage::Format_RGB32);
+    }
+    m_premultiplied = m_image.pixelFormat().premultiplied() == QPixelFormat::Premultiplied;
+    
+    // constScanLine() never detaches, so these stay valid while m_image
+    // holds the pixels
+    m_lines.resize(m_image.height());
+    for (int y = 0; y < m_image.height(); ++y) {
+        m_lines[y] = reinterpret_cast<const QRgb *>(m_image.constScanLine(y));
+    }
+}
+
+void PixelLoupe::clear()
+{
+    m_lines.clear();
+    m_image = QImage();
+    m_visible = false;
+}
+
+void PixelLoupe::setCoordinateOffset(const QPoint &offset)
+{
+    m_offset = offset;
+}
+
+bool PixelLoupe::isVisible() const
+{
+    return m_visible;
+}
+
+QRect PixelLoupe::rect() const
+{
+    return m_visible ? m_rect : QRect();
+}
+
+QRegion PixelLoupe::moveTo(const QPoint &pixel, const QPoint &cursor, const QRect &bounds)
+{
+    QRegion damage(rect());
+    
+    // Below and right of the cursor, flipped to the other side near an edge
+    const QSize size(GridSize + 2, GridSize + TextHeight + 2);
+    int x = cursor.x() + CursorGap;
+    int y = cursor.y() + CursorGap;
+    if (x + size.width() > bounds.right()) {
+        x = cursor.x() - CursorGap - size.width();
+    }
+    if (y + size.height() > bounds.bottom()) {
+        y = cursor.y() - CursorGap - size.height();
+    }
+    x = qBound(bounds.left(), x, qMax(bounds.left(), bounds.right() - size.width()));
+    y = qBound(bounds.top(), y, qMax(bounds.top(), bounds.bottom() - size.height()));
+    
+    m_pixel = pixel;
+    m_rect = QRect(QPoint(x, y), size);
+    m_visible = !m_image.isNull();
+    
+    damage += rect();
+    return damage;
+}
+
+QRegion PixelLoupe::hide()
+{
+    const QRegion damage(rect());
+    m_visible = false;
+    return damage;
+}
+
+QRgb PixelLoupe::pixelAt(int x, int y, bool *inside) const
+{
+    *inside = x >= 0 && y >= 0 && x < m_image.width() && y < m_image.height();
+    if (!*inside) {
+        return 0;
+    }
+    const QRgb value = m_lines.at(y)[x];
+    return m_premultiplied ? qUnpremultiply(value) : value;
+}
+
+void PixelLoupe::paint(QPainter &painter) const
+{
+    if (!m_visible) {
+        return;
+    }
+    
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing, false);
+    
+    // Frame and background
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(30, 30, 46, 235));
+    painter.drawRect(m_rect);
+    
+    // One flat cell per pixel; pixels off the image stay background
+    const QPoint grid = m_rect.topLeft() + QPoint(1, 1);
+    const int half = Cells / 2;
+    for (int row = 0; row < Cells; ++row) {
+        for (int column = 0; column < Cells; ++column) {
+            bool inside;
+            const QRgb value = pixelAt(m_pixel.x() - half + column, m_pixel.y() - half + row, &inside);
+            if (inside) {
+                painter.fillRect(grid.x() + column * CellSize, grid.y() + row * CellSize,
+                                 CellSize, CellSize, QColor(qRed(value), qGreen(value), qBlue(value)));
+            }
+        }
+    }
+    
+    // Grid lines between cells
+    painter.setPen(QColor(0, 0, 0, 50));
+    for (int i = 1; i < Cells; ++i) {
+        painter.drawLine(grid.x() + i * CellSize, grid.y(), grid.x() + i * CellSize, grid.y() + GridSize - 1);
+        painter.drawLine(grid.x(), grid.y() + i * CellSize, grid.x() + GridSize - 1, grid.y() + i * CellSize);
+    }
+    
+    // The pixel under the cursor, outlined so it shows on any colour
+    const QRect centre(grid.x() + half * CellSize, grid.y() + half * CellSize, CellSize, CellSize);
+    painter.setBrush(Qt::NoBrush);
+    painter.setPen(Qt::black);
+    painter.drawRect(centre.adjusted(-1, -1, 0, 0));
+    painter.setPen(Qt::white);
+    painter.drawRect(centre.adjusted(-2, -2, 1, 1));
+    
+    // Readout: coordinate, then hex and RGB
+    bool inside;
+    const QRgb value = pixelAt(m_pixel.x(), m_pixel.y(), &inside);
+    const QPoint shown = m_pixel + m_offset;
+    const QString coordinate = QString("%1, %2").arg(shown.x()).arg(shown.y());
+    const QString colour = inside
+        ? QString("#%1  %2 %3 %4")
+              .arg(value & 0xFFFFFF, 6, 16, QChar('0')).toUpper()
+              .arg(qRed(value)).arg(qGreen(value)).arg(qBlue(value))
+        : QString("outside");
+    
+    painter.setFont(m_font);
+    painter.setPen(QColor(0xE0, 0xE0, 0xE0));
+    const int textX = m_rect.x() + 8;
+    const int firstLine = grid.y() + GridSize + 4 + m_metrics.ascent();
+    painter.drawText(textX, firstLine, coordinate);
+    painter.drawText(textX, firstLine + m_metrics.height(), colour);
+    
+    if (inside) {
+        painter.fillRect(m_rect.right() - 20, grid.y() + GridSize + 8, 14, 14,
+                         QColor(qRed(value), qGreen(value), qBlue(value)));
+    }
+    
+    painter.restore();
+}
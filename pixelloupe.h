@@ -0,0 +1,56 @@
+#ifndef PIXELLOUPE_H
+#define PIXELLOUPE_H
+
+#include <QColor>
+#include <QFont>
+#include <QFontMetrics>
+#include <QImage>
+#include <QRect>
+#include <QRegion>
+#include <QVector>
+
+class QPainter;
+
+// Magnified pixel grid around the cursor with the colour and coordinate
+// of the pixel under it. Not a widget: the overlay and the picker view
+// each own one and paint it last, so moving it only repaints its own
+// rect. Pixels come straight from row pointers into the source image;
+// nothing is converted or scaled per move.
+class PixelLoupe
+{
+public:
+    PixelLoupe();
+
+    // Shared, not copied. Images that are not 32-bit are converted once.
+    void setImage(const QImage &image);
+    void clear();
+    // Added to the pixel coordinate shown in the readout
+    void setCoordinateOffset(const QPoint &offset);
+
+    bool isVisible() const;
+    QRect rect() const;
+
+    // Centre on a source pixel, placed next to cursor and kept inside
+    // bounds (both in the host widget's coordinates). Returns the area to
+    // repaint: where the loupe was and where it is now.
+    QRegion moveTo(const QPoint &pixel, const QPoint &cursor, const QRect &bounds);
+    // Returns the area it covered
+    QRegion hide();
+
+    void paint(QPainter &painter) const;
+
+private:
+    QRgb pixelAt(int x, int y, bool *inside) const;
+
+    QImage m_image;
+    QVector<const QRgb *> m_lines;   // Scanline cache of m_image
+    bool m_premultiplied;
+    QPoint m_pixel;
+    QPoint m_offset;
+    QRect m_rect;
+    bool m_visible;
+    QFont m_font;
+    QFontMetrics m_metrics;
+};
+
+#endif // PIXELLOUPE_H
@@ -0,0 +1,290 @@
+#include "pointexporter.h"
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const int BufferSize = 64 * 1024;
+
+// Longest single record, well above a CSV or JSON line of ten numbers
+const int MaxRecord = 512;
+
+// Points between progress callbacks
+const int ProgressInterval = 4096;
+
+const quint32 BinaryVersion = 1;
+
+// Fixed buffer in front of the file; records are formatted in place
+class RecordWriter
+{
+public:
+    explicit RecordWriter(QSaveFile *file)
+        : m_file(file)
+        , m_used(0)
+        , m_failed(false)
+    {
+    }
+    
+    // Room for one more record, flushing first if needed
+    void reserveRecord()
+    {
+        if (m_used > BufferSize - MaxRecord) {
+            flush();
+        }
+    }
+    
+    void appendBytes(const char *data, int size)
+    {
+        std::memcpy(m_buffer + m_used, data, size);
+        m_used += size;
+    }
+    
+    void append(const QByteArray &bytes)
+    {
+        appendBytes(bytes.constData(), bytes.size());
+    }
+    
+    void append(char c)
+    {
+        m_buffer[m_used++] = c;
+    }
+    
+    void appendLiteral(const char *text)
+    {
+        appendBytes(text, int(std::strlen(text)));
+    }
+    
+    void appendNumber(qint64 value)
+    {
+        char digits[24];
+        int count = 0;
+        quint64 magnitude = value < 0 ? quint64(-(value + 1)) + 1 : quint64(value);
+        do {
+            digits[count++] = char('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+        if (value < 0) {
+            append('-');
+        }
+        while (count > 0) {
+            append(digits[--count]);
+        }
+    }
+    
+    void appendInt32(qint32 value)
+    {
+        qToLittleEndian(value, m_buffer + m_used);
+        m_used += 4;
+    }
+    
+    void appendUInt32(quint32 value)
+    {
+        qToLittleEndian(value, m_buffer + m_used);
+        m_used += 4;
+    }
+    
+    void appendDouble(double value)
+    {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian(bits, m_buffer + m_used);
+        m_used += 8;
+    }
+    
+    bool flush()
+    {
+        if (m_used > 0 && !m_failed) {
+            m_failed = m_file->write(m_buffer, m_used) != m_used;
+        }
+        m_used = 0;
+        return !m_failed;
+    }
+    
+    bool failed() const
+    {
+        return m_failed;
+    }
+
+private:
+    QSaveFile *m_file;
+    char m_buffer[BufferSize];
+    int m_used;
+    bool m_failed;
+};
+
+QByteArray ratioText(qreal ratio)
+{
+    return QByteArray::number(ratio, 'g', 6);
+}
+
+void writeHeader(RecordWriter &out, const PointExportMetadata &metadata,
+                 PointExporter::Format format, int count)
+{
+    out.reserveRecord();
+    switch (format) {
+    case PointExporter::Csv:
+        out.appendLiteral("index,x,y,ref_x,ref_y,source_width,source_height,device_pixel_ratio\n");
+        break;
+    case PointExporter::JsonLines:
+        out.appendLiteral("{\"type\":\"capture\",\"source_width\":");
+        out.appendNumber(metadata.sourceSize.width());
+        out.appendLiteral(",\"source_height\":");
+        out.appendNumber(metadata.sourceSize.height());
+        out.appendLiteral(",\"device_pixel_ratio\":");
+        out.append(ratioText(metadata.devicePixelRatio));
+        out.appendLiteral(",\"reference_width\":");
+        out.appendNumber(metadata.referenceSize.width());
+        out.appendLiteral(",\"reference_height\":");
+        out.appendNumber(metadata.referenceSize.height());
+        out.appendLiteral(",\"points\":");
+        out.appendNumber(count);
+        out.appendLiteral("}\n");
+        break;
+    case PointExporter::Binary:
+        out.appendBytes("CSPT", 4);
+        out.appendUInt32(BinaryVersion);
+        out.appendUInt32(quint32(count));
+        out.appendInt32(metadata.sourceSize.width());
+        out.appendInt32(metadata.sourceSize.height());
+        out.appendInt32(metadata.referenceSize.width());
+        out.appendInt32(metadata.referenceSize.height());
+        out.appendDouble(metadata.devicePixelRatio);
+        break;
+    }
+}
+
+} // namespace
+
+QPoint PointExportMetadata::toReference(const QPoint &pixel) const
+{
+    if (sourceSize.isEmpty()) {
+        return pixel;
+    }
+    return QPoint(int((2 * qint64(pixel.x()) + 1) * referenceSize.width() /
+                      (2 * qint64(sourceSize.width()))),
+                  int((2 * qint64(pixel.y()) + 1) * referenceSize.height() /
+                      (2 * qint64(sourceSize.height()))));
+}
+
+QPoint PointExportMetadata::fromReference(const QPoint &reference) const
+{
+    if (sourceSize.isEmpty()) {
+        return reference;
+    }
+    return QPoint(int((2 * qint64(reference.x()) + 1) * sourceSize.width() /
+                      (2 * qint64(referenceSize.width()))),
+                  int((2 * qint64(reference.y()) + 1) * sourceSize.height() /
+                      (2 * qint64(referenceSize.height()))));
+}
+
+PointExporter::Format PointExporter::formatForPath(const QString &filePath)
+{
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (suffix == "jsonl" || suffix == "ndjson") {
+        return JsonLines;
+    }
+    if (suffix == "bin") {
+        return Binary;
+    }
+    return Csv;
+}
+
+QString PointExporter::fileDialogFilter()
+{
+    return "CSV (*.csv);;JSON Lines (*.jsonl);;Binary (*.bin)";
+}
+
+bool PointExporter::write(const QVector<QPoint> &points, const PointExportMetadata &metadata,
+                          const QString &filePath, Format format,
+                          const std::function<bool(int, int)> &progress, QString *error)
+{
+    // Written under a temporary name and renamed on commit, so a
+    // cancelled or failed export leaves no partial file
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    
+    // Large enough that it should not live on a worker's stack
+    QScopedPointer<RecordWriter> out(new RecordWriter(&file));
+    writeHeader(*out, metadata, format, points.size());
+    
+    // The metadata columns are the same on every CSV row
+    QByteArray csvTail;
+    if (format == Csv) {
+        csvTail = ',' + QByteArray::number(metadata.sourceSize.width()) +
+                  ',' + QByteArray::number(metadata.sourceSize.height()) +
+                  ',' + ratioText(metadata.devicePixelRatio) + '\n';
+    }
+    
+    const int total = points.size();
+    for (int i = 0; i < total; ++i) {
+        const QPoint &pixel = points.at(i);
+        const QPoint reference = metadata.toReference(pixel);
+        
+        out->reserveRecord();
+        switch (format) {
+        case Csv:
+            out->appendNumber(i + 1);
+            out->append(',');
+            out->appendNumber(pixel.x());
+            out->append(',');
+            out->appendNumber(pixel.y());
+            out->append(',');
+            out->appendNumber(reference.x());
+            out->append(',');
+            out->appendNumber(reference.y());
+            out->append(csvTail);
+            break;
+        case JsonLines:
+            out->appendLiteral("{\"type\":\"point\",\"index\":");
+            out->appendNumber(i + 1);
+            out->appendLiteral(",\"x\":");
+            out->appendNumber(pixel.x());
+            out->appendLiteral(",\"y\":");
+            out->appendNumber(pixel.y());
+            out->appendLiteral(",\"ref_x\":");
+            out->appendNumber(reference.x());
+            out->appendLiteral(",\"ref_y\":");
+            out->appendNumber(reference.y());
+            out->appendLiteral("}\n");
+            break;
+        case Binary:
+            out->appendInt32(pixel.x());
+            out->appendInt32(pixel.y());
+            out->appendInt32(reference.x());
+            out->appendInt32(reference.y());
+            break;
+        }
+        
+        if ((i + 1) % ProgressInterval == 0) {
+            if (out->failed()) {
+                break;
+            }
+            if (progress && !progress(i + 1, total)) {
+                file.cancelWriting();
+                file.commit();
+                if (error) {
+                    *error = "Export cancelled";
+                }
+                return false;
+            }
+        }
+    }
+    
+    if (!out->flush() || !file.commit()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    if (progress) {
+        progress(total, total);
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef POINTEXPORTER_H
+#define POINTEXPORTER_H
+
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// The capture picked points belong to, written alongside them
+struct PointExportMetadata
+{
+    QSize sourceSize;
+    qreal devicePixelRatio = 1.0;
+    QSize referenceSize = QSize(1920, 1080);
+
+    // Maps pixel centres, so each source pixel lands on exactly one
+    // reference pixel whatever the capture size
+    QPoint toReference(const QPoint &pixel) const;
+    // The source pixel whose centre maps to this reference pixel
+    QPoint fromReference(const QPoint &reference) const;
+};
+
+// Streams picked points to a file. Each point is written with its source
+// pixel and reference-space coordinate, formatted straight into a 64 KB
+// buffer, so nothing is allocated per point and memory stays flat at any
+// count. Formats:
+//
+//   csv    header row, then index,x,y,ref_x,ref_y,source_width,
+//          source_height,device_pixel_ratio
+//   jsonl  a "capture" object with the metadata, then one "point" object
+//          per line
+//   bin    "CSPT" header (version, count, sizes, pixel ratio), then
+//          x, y, ref_x, ref_y as little-endian int32 per point
+class PointExporter
+{
+public:
+    enum Format {
+        Csv,
+        JsonLines,
+        Binary
+    };
+
+    // From the file suffix; CSV when it is not one of ours
+    static Format formatForPath(const QString &filePath);
+    static QString fileDialogFilter();
+
+    // Safe to call from any thread. progress(done, total) is called
+    // every few thousand points; returning false cancels the export and
+    // leaves no file behind. Returns false with error set on failure or
+    // cancellation.
+    static bool write(const QVector<QPoint> &points, const PointExportMetadata &metadata,
+                      const QString &filePath, Format format,
+                      const std::function<bool(int, int)> &progress, QString *error);
+};
+
+#endif // POINTEXPORTER_H
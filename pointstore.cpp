@@ -0,0 +1,327 @@
+#include "pointstore.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Grid cell edge in source pixels
+const int CellSize = 32;
+
+// Compact only once this many tombstones have built up
+const int CompactThreshold = 1024;
+
+inline int cellOf(qreal coordinate)
+{
+    return int(std::floor(coordinate / CellSize));
+}
+
+inline quint64 cellKey(int cellX, int cellY)
+{
+    return (quint64(quint32(cellY)) << 32) | quint32(cellX);
+}
+
+inline quint64 cellKeyOf(const QPoint &point)
+{
+    return cellKey(cellOf(point.x()), cellOf(point.y()));
+}
+
+inline int lowBit(int i)
+{
+    return i & -i;
+}
+
+} // namespace
+
+PointStore::PointStore(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_count(0)
+{
+    m_tree.append(0);
+}
+
+int PointStore::count() const
+{
+    return m_count;
+}
+
+QPoint PointStore::at(int row) const
+{
+    return m_slots.at(slotAt(row));
+}
+
+QVector<QPoint> PointStore::points() const
+{
+    QVector<QPoint> result;
+    result.reserve(m_count);
+    for (int slot = 0; slot < m_slots.size(); ++slot) {
+        if (m_live.at(slot)) {
+            result.append(m_slots.at(slot));
+        }
+    }
+    return result;
+}
+
+void PointStore::append(const QPoint &point)
+{
+    beginInsertRows(QModelIndex(), m_count, m_count);
+    appendSlot(point);
+    endInsertRows();
+}
+
+void PointStore::append(const QVector<QPoint> &points)
+{
+    if (points.isEmpty()) {
+        return;
+    }
+    
+    beginInsertRows(QModelIndex(), m_count, m_count + points.size() - 1);
+    m_slots.reserve(m_slots.size() + points.size());
+    m_live.reserve(m_live.size() + points.size());
+    m_tree.reserve(m_tree.size() + points.size());
+    for (const QPoint &point : points) {
+        appendSlot(point);
+    }
+    endInsertRows();
+}
+
+void PointStore::removeAt(int row)
+{
+    if (row < 0 || row >= m_count) {
+        return;
+    }
+    
+    beginRemoveRows(QModelIndex(), row, row);
+    killSlot(slotAt(row));
+    endRemoveRows();
+    compact();
+}
+
+void PointStore::remove(QVector<int> rows)
+{
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    
+    // Highest rows first, one notification per contiguous run, so the
+    // rows still to be removed keep their numbers
+    int i = 0;
+    while (i < rows.size()) {
+        const int last = rows.at(i);
+        int first = last;
+        while (i + 1 < rows.size() && rows.at(i + 1) == first - 1) {
+            first = rows.at(++i);
+        }
+        ++i;
+        if (first < 0 || last >= m_count) {
+            continue;
+        }
+        
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = last; row >= first; --row) {
+            killSlot(slotAt(row));
+        }
+        endRemoveRows();
+    }
+    compact();
+}
+
+void PointStore::clear()
+{
+    beginResetModel();
+    m_slots.clear();
+    m_live.clear();
+    m_tree.resize(1);
+    m_grid.clear();
+    m_count = 0;
+    endResetModel();
+}
+
+int PointStore::findNear(const QPointF &pos, qreal radius) const
+{
+    int best = -1;
+    const qreal radius2 = radius * radius;
+    
+    // Points are tested by pixel centre, so the cells are offset by half
+    for (int cy = cellOf(pos.y() - radius - 0.5); cy <= cellOf(pos.y() + radius - 0.5); ++cy) {
+        for (int cx = cellOf(pos.x() - radius - 0.5); cx <= cellOf(pos.x() + radius - 0.5); ++cx) {
+            const auto cell = m_grid.constFind(cellKey(cx, cy));
+            if (cell == m_grid.constEnd()) {
+                continue;
+            }
+            for (int slot : *cell) {
+                const QPoint &point = m_slots.at(slot);
+                const qreal dx = point.x() + 0.5 - pos.x();
+                const qreal dy = point.y() + 0.5 - pos.y();
+                if (slot > best && dx * dx + dy * dy <= radius2) {
+                    best = slot;
+                }
+            }
+        }
+    }
+    return best < 0 ? -1 : rowOf(best);
+}
+
+void PointStore::forEachIn(const QRectF &rect,
+                           const std::function<void(int, const QPoint &)> &visit) const
+{
+    const QRectF centres = rect.translated(-0.5, -0.5);
+    const int firstX = cellOf(centres.left());
+    const int lastX = cellOf(centres.right());
+    const int firstY = cellOf(centres.top());
+    const int lastY = cellOf(centres.bottom());
+    const qint64 cells = qint64(lastX - firstX + 1) * (lastY - firstY + 1);
+    
+    // A rect covering most of the points is cheaper to walk in order
+    if (cells >= m_grid.size()) {
+        int row = 0;
+        for (int slot = 0; slot < m_slots.size(); ++slot) {
+            if (!m_live.at(slot)) {
+                continue;
+            }
+            if (centres.contains(m_slots.at(slot))) {
+                visit(row, m_slots.at(slot));
+            }
+            ++row;
+        }
+        return;
+    }
+    
+    QVector<int> found;
+    for (int cy = firstY; cy <= lastY; ++cy) {
+        for (int cx = firstX; cx <= lastX; ++cx) {
+            const auto cell = m_grid.constFind(cellKey(cx, cy));
+            if (cell == m_grid.constEnd()) {
+                continue;
+            }
+            for (int slot : *cell) {
+                if (centres.contains(m_slots.at(slot))) {
+                    found.append(slot);
+                }
+            }
+        }
+    }
+    std::sort(found.begin(), found.end());
+    for (int slot : found) {
+        visit(rowOf(slot), m_slots.at(slot));
+    }
+}
+
+void PointStore::setDisplayMapping(const std::function<QPoint(const QPoint &)> &mapping)
+{
+    m_mapping = mapping;
+    refreshDisplay();
+}
+
+QPoint PointStore::displayPoint(const QPoint &point) const
+{
+    return m_mapping ? m_mapping(point) : point;
+}
+
+void PointStore::refreshDisplay()
+{
+    if (m_count > 0) {
+        emit dataChanged(index(0), index(m_count - 1), {Qt::DisplayRole});
+    }
+}
+
+int PointStore::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_count;
+}
+
+QVariant PointStore::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_count) {
+        return QVariant();
+    }
+    
+    const QPoint point = at(index.row());
+    if (role == Qt::DisplayRole) {
+        const QPoint shown = displayPoint(point);
+        return QString("Point %1: (%2, %3)").arg(index.row() + 1).arg(shown.x()).arg(shown.y());
+    }
+    if (role == Qt::UserRole) {
+        return point;
+    }
+    return QVariant();
+}
+
+int PointStore::slotAt(int row) const
+{
+    // Walk down the tree to the (row + 1)th live slot
+    const int size = m_tree.size() - 1;
+    int step = 1;
+    while (step * 2 <= size) {
+        step *= 2;
+    }
+    
+    int position = 0;
+    int remaining = row + 1;
+    for (; step > 0; step /= 2) {
+        if (position + step <= size && m_tree.at(position + step) < remaining) {
+            position += step;
+            remaining -= m_tree.at(position);
+        }
+    }
+    return position;
+}
+
+int PointStore::rowOf(int slot) const
+{
+    // Live slots before this one
+    int row = 0;
+    for (int i = slot; i > 0; i -= lowBit(i)) {
+        row += m_tree.at(i);
+    }
+    return row;
+}
+
+void PointStore::appendSlot(const QPoint &point)
+{
+    const int slot = m_slots.size();
+    m_slots.append(point);
+    m_live.append(true);
+    
+    // The new node covers (i - lowBit(i), i]; sum the nodes below it
+    const int i = slot + 1;
+    int sum = 1;
+    for (int j = i - 1; j > i - lowBit(i); j -= lowBit(j)) {
+        sum += m_tree.at(j);
+    }
+    m_tree.append(sum);
+    
+    m_grid[cellKeyOf(point)].append(slot);
+    ++m_count;
+}
+
+void PointStore::killSlot(int slot)
+{
+    m_live[slot] = false;
+    for (int i = slot + 1; i < m_tree.size(); i += lowBit(i)) {
+        --m_tree[i];
+    }
+    
+    QVector<int> &cell = m_grid[cellKeyOf(m_slots.at(slot))];
+    const int at = cell.indexOf(slot);
+    cell[at] = cell.last();
+    cell.removeLast();
+    --m_count;
+}
+
+void PointStore::compact()
+{
+    const int dead = m_slots.size() - m_count;
+    if (dead < CompactThreshold || dead < m_count) {
+        return;
+    }
+    
+    // Rows keep their order, so views need no notification
+    QVector<QPoint> live = points();
+    m_slots.clear();
+    m_live.clear();
+    m_tree.resize(1);
+    m_grid.clear();
+    m_count = 0;
+    for (const QPoint &point : live) {
+        appendSlot(point);
+    }
+}
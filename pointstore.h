@@ -0,0 +1,68 @@
+#ifndef POINTSTORE_H
+#define POINTSTORE_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPoint>
+#include <QRectF>
+#include <QVector>
+#include <functional>
+
+// Picked points in source pixels, shared by the picker's image view and
+// its list. Rows are points in the order they were added.
+//
+// Removing a point leaves a tombstone instead of shifting the rest; a
+// Fenwick tree over live slots turns slots into rows and back in
+// O(log n). A uniform grid over source pixels finds points near the
+// cursor or inside the view without a scan. Tombstones are compacted
+// away once they outnumber live points.
+class PointStore : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit PointStore(QObject *parent = nullptr);
+
+    int count() const;
+    QPoint at(int row) const;
+    // All points in row order
+    QVector<QPoint> points() const;
+
+    void append(const QPoint &point);
+    void append(const QVector<QPoint> &points);
+    void removeAt(int row);
+    void remove(QVector<int> rows);
+    void clear();
+
+    // Row of the most recently added point whose pixel centre is within
+    // radius of pos (source pixels); -1 if none
+    int findNear(const QPointF &pos, qreal radius) const;
+    // Calls visit(row, point) in row order for points centred in rect
+    void forEachIn(const QRectF &rect,
+                   const std::function<void(int, const QPoint &)> &visit) const;
+
+    // How the list shows a point; source pixels unless set
+    void setDisplayMapping(const std::function<QPoint(const QPoint &)> &mapping);
+    QPoint displayPoint(const QPoint &point) const;
+    // Call when the mapping's result changes
+    void refreshDisplay();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    int slotAt(int row) const;
+    int rowOf(int slot) const;
+    void appendSlot(const QPoint &point);
+    void killSlot(int slot);
+    void compact();
+
+    QVector<QPoint> m_slots;
+    QVector<bool> m_live;
+    QVector<int> m_tree;                   // Fenwick tree over m_live, 1-based
+    QHash<quint64, QVector<int>> m_grid;   // Slots per grid cell
+    int m_count;
+    std::function<QPoint(const QPoint &)> m_mapping;
+};
+
+#endif // POINTSTORE_H
@@ -0,0 +1,222 @@
+#include "regionwatcher.h"
+#include "screencapture.h"
+#include "imageops.h"
+#include "savequeue.h"
+#include <QDateTime>
+#include <QDir>
+#include <QTimer>
+
+namespace {
+
+// Polls are hashed on a 4× downsampled copy in 16 px tiles, so each tile
+// covers 64 × 64 source pixels
+const int PollDownsample = 4;
+const int PollTileSize = 16;
+
+} // namespace
+
+QString RegionWatchStats::summary() const
+{
+    QString text = QString("%1 changes in %2 polls over %3 s • %4 ms per poll")
+                   .arg(changes)
+                   .arg(polls)
+                   .arg(elapsedMs / 1000.0, 0, 'f', 1)
+                   .arg(pollMs, 0, 'f', 1);
+    if (failed > 0) {
+        text += QString(" • %1 failed").arg(failed);
+    }
+    return text;
+}
+
+RegionWatcher::RegionWatcher(const RegionWatchSettings &settings, QObject *parent)
+    : QObject(parent)
+    , m_settings(settings)
+    , m_pollTimer(new QTimer(this))
+    , m_saveQueue(new SaveQueue(this))
+    , m_stopMs(0)
+    , m_pollNs(0)
+    , m_running(false)
+    , m_stopping(false)
+{
+    m_saveQueue->setSyncPolicy(m_settings.sync);
+    m_pollTimer->setInterval(qMax(1, m_settings.pollMs));
+    connect(m_pollTimer, &QTimer::timeout, this, &RegionWatcher::poll);
+    
+    connect(m_saveQueue, &SaveQueue::saved, this, [this]() { saveFinished(true); });
+    connect(m_saveQueue, &SaveQueue::failed, this, [this]() { saveFinished(false); });
+}
+
+RegionWatcher::~RegionWatcher()
+{
+    m_pollTimer->stop();
+    m_saveQueue->waitForDone();
+}
+
+bool RegionWatcher::start(QString *error)
+{
+    if (m_running) {
+        return true;
+    }
+    
+    if (!QDir().mkpath(m_settings.outputDir)) {
+        if (error) {
+            *error = "Cannot create folder " + m_settings.outputDir;
+        }
+        return false;
+    }
+    
+    m_manifest.setFileName(QDir(m_settings.outputDir).filePath("changes.csv"));
+    if (!m_manifest.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) {
+            *error = "Cannot write " + m_manifest.fileName();
+        }
+        return false;
+    }
+    m_manifest.write("sequence,wall_clock,x,y,width,height,changed_percent,file\n");
+    
+    m_running = true;
+    m_clock.start();
+    m_pollTimer->start();
+    poll();
+    return true;
+}
+
+void RegionWatcher::stop()
+{
+    if (!m_running || m_stopping) {
+        return;
+    }
+    
+    m_stopping = true;
+    m_stopMs = m_clock.elapsed();
+    m_pollTimer->stop();
+    finishIfDone();
+}
+
+bool RegionWatcher::isRunning() const
+{
+    return m_running;
+}
+
+RegionWatchStats RegionWatcher::stats() const
+{
+    RegionWatchStats result = m_stats;
+    result.elapsedMs = m_stopping ? m_stopMs : m_clock.elapsed();
+    if (result.polls > 0) {
+        result.pollMs = m_pollNs / 1e6 / result.polls;
+    }
+    return result;
+}
+
+void RegionWatcher::poll()
+{
+    if (m_stopping) {
+        return;
+    }
+    
+    QElapsedTimer pollTimer;
+    pollTimer.start();
+    
+    // Qt cannot grab at a reduced resolution, so the full grab is reduced
+    // here before hashing and kept in case it has to be saved
+    QImage frame = ScreenCapture::grabRegion(m_settings.region, m_settings.screenIndex);
+    if (frame.isNull()) {
+        return;
+    }
+    // The ImageOps kernels work on 32-bit pixels only
+    if (frame.format() != QImage::Format_RGB32 &&
+        frame.format() != QImage::Format_ARGB32_Premultiplied) {
+        frame = frame.convertToFormat(QImage::Format_RGB32);
+    }
+    
+    const QImage reduced = ImageOps::boxDownsample(frame, PollDownsample);
+    const QVector<quint64> hashes = ImageOps::tileHashes(reduced, PollTileSize);
+    
+    int changedTiles = 0;
+    const QRect area = changedArea(hashes, frame.size(), &changedTiles);
+    
+    ++m_stats.polls;
+    m_pollNs += pollTimer.nsecsElapsed();
+    
+    const double changedPercent = 100.0 * changedTiles / qMax(1, hashes.size());
+    const bool baseline = m_previousHashes.isEmpty();
+    if (changedTiles == 0 || (!baseline && changedPercent <= m_settings.thresholdPercent)) {
+        return;
+    }
+    
+    // Compare later polls with the frame that was saved, not the last
+    // poll, so slow changes still add up to the threshold
+    m_previousHashes = hashes;
+    m_previousSize = frame.size();
+    
+    const quint64 sequence = ++m_stats.changes;
+    const QString fileName = QString("change_%1.%2")
+                             .arg(sequence, 6, 10, QChar('0'))
+                             .arg(QString::fromLatin1(m_settings.format));
+    const QString filePath = QDir(m_settings.outputDir).filePath(fileName);
+    m_saveQueue->enqueue(frame, filePath, m_settings.preset);
+    
+    const QString line = QString("%1,%2,%3,%4,%5,%6,%7,%8\n")
+                         .arg(sequence)
+                         .arg(QDateTime::currentDateTime().toString(Qt::ISODateWithMs))
+                         .arg(area.x())
+                         .arg(area.y())
+                         .arg(area.width())
+                         .arg(area.height())
+                         .arg(changedPercent, 0, 'f', 1)
+                         .arg(fileName);
+    m_manifest.write(line.toUtf8());
+    
+    emit changed(area, frame, filePath);
+    
+    if (m_settings.changeLimit > 0 && sequence >= static_cast<quint64>(m_settings.changeLimit)) {
+        stop();
+    }
+}
+
+QRect RegionWatcher::changedArea(const QVector<quint64> &hashes, const QSize &imageSize,
+                                 int *changedTiles) const
+{
+    // The first poll, or a region whose size changed, counts as all new
+    if (m_previousHashes.size() != hashes.size() || m_previousSize != imageSize) {
+        *changedTiles = hashes.size();
+        return QRect(QPoint(0, 0), imageSize);
+    }
+    
+    const int tileSpan = PollTileSize * PollDownsample;
+    const int columns = (imageSize.width() + tileSpan - 1) / tileSpan;
+    
+    QRect area;
+    int count = 0;
+    for (int i = 0; i < hashes.size(); ++i) {
+        if (hashes.at(i) != m_previousHashes.at(i)) {
+            ++count;
+            area |= QRect((i % columns) * tileSpan, (i / columns) * tileSpan,
+                          tileSpan, tileSpan);
+        }
+    }
+    
+    *changedTiles = count;
+    return area.intersected(QRect(QPoint(0, 0), imageSize));
+}
+
+void RegionWatcher::saveFinished(bool ok)
+{
+    if (ok) {
+        ++m_stats.saved;
+    } else {
+        ++m_stats.failed;
+    }
+    finishIfDone();
+}
+
+void RegionWatcher::finishIfDone()
+{
+    if (!m_stopping || !m_running || m_saveQueue->pendingCount() > 0) {
+        return;
+    }
+    
+    m_manifest.close();
+    m_running = false;
+    emit finished(stats());
+}
@@ -0,0 +1,95 @@
+#ifndef REGIONWATCHER_H
+#define REGIONWATCHER_H
+
+#include <QObject>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QFile>
+#include "imageencoder.h"
+
+class QTimer;
+class SaveQueue;
+
+struct RegionWatchSettings
+{
+    QRect region;              // Logical virtual-desktop coordinates
+    int screenIndex = -1;      // Or relative to this screen
+    int pollMs = 500;
+    double thresholdPercent = 0.0;  // Changed tiles needed to save; 0 = any
+    int changeLimit = 0;       // Stop after this many saved frames; 0 = until stop()
+    QString outputDir;
+    QByteArray format = "png";
+    ImageEncoder::Preset preset = ImageEncoder::FastPng;  // Applies when format matches it
+    CaptureFileWriter::SyncPolicy sync = CaptureFileWriter::NoSync;
+};
+
+struct RegionWatchStats
+{
+    quint64 polls = 0;
+    quint64 changes = 0;       // Polls over the threshold, saved
+    quint64 saved = 0;
+    quint64 failed = 0;
+    qint64 elapsedMs = 0;
+    double pollMs = 0.0;       // Average grab + hash + compare time
+
+    QString summary() const;
+};
+
+// Polls a fixed region and saves a frame only when it changes. Each poll
+// is reduced to a small grid of tile hashes from a downsampled copy, so
+// unchanged polls cost a grab and a hash instead of an encode. The first
+// poll is saved as the baseline; after that a frame is saved when the
+// share of changed tiles exceeds the threshold. Saved frames are listed
+// in changes.csv in the output folder together with the changed area.
+class RegionWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RegionWatcher(const RegionWatchSettings &settings, QObject *parent = nullptr);
+    ~RegionWatcher();
+
+    bool start(QString *error = nullptr);
+    // Stop polling; queued saves still complete before finished()
+    void stop();
+    bool isRunning() const;
+
+    RegionWatchStats stats() const;
+
+signals:
+    // changedArea is the bounding box of the changed tiles in the
+    // physical pixels of frame
+    void changed(const QRect &changedArea, const QImage &frame, const QString &filePath);
+    void finished(const RegionWatchStats &stats);
+
+private slots:
+    void poll();
+
+private:
+    QRect changedArea(const QVector<quint64> &hashes, const QSize &imageSize,
+                      int *changedTiles) const;
+    void saveFinished(bool ok);
+    void finishIfDone();
+
+    RegionWatchSettings m_settings;
+    QTimer *m_pollTimer;
+    SaveQueue *m_saveQueue;
+    QElapsedTimer m_clock;
+    qint64 m_stopMs;
+    qint64 m_pollNs;
+    RegionWatchStats m_stats;
+    bool m_running;
+    bool m_stopping;
+
+    // Hashes of the last saved frame, compared tile by tile with each poll
+    QVector<quint64> m_previousHashes;
+    QSize m_previousSize;
+
+    QFile m_manifest;
+};
+
+#endif // REGIONWATCHER_H
@@ -0,0 +1,83 @@
+#include "savequeue.h"
+#include "capturetrace.h"
+#include <QThreadPool>
+#include <QThread>
+
+SaveQueue::SaveQueue(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_syncPolicy(CaptureFileWriter::NoSync)
+    , m_nextId(1)
+    , m_pendingCount(0)
+{
+    // Leave one core for the GUI thread
+    m_pool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+SaveQueue::~SaveQueue()
+{
+    // Never drop a capture on exit; finish writing whatever is queued
+    m_pool->waitForDone();
+}
+
+int SaveQueue::enqueue(const QImage &image, const QString &filePath,
+                       ImageEncoder::Preset preset, int traceId, bool replace)
+{
+    const QByteArray format = ImageEncoder::formatForPath(filePath, preset);
+    return enqueue(SharedEncodedImage(new EncodedImage(image, format, preset)), filePath, traceId,
+                   replace);
+}
+
+int SaveQueue::enqueue(const SharedEncodedImage &encoded, const QString &filePath, int traceId,
+                       bool replace)
+{
+    const int id = m_nextId++;
+    ++m_pendingCount;
+    
+    CaptureFileWriter::Options options;
+    options.sync = m_syncPolicy;
+    options.replace = replace;
+    m_pool->start([this, id, encoded, filePath, traceId, options]() {
+        const qint64 startNs = CaptureTrace::now();
+        const EncodeResult result = ImageEncoder::write(*encoded, filePath, options);
+        if (traceId > 0) {
+            const qint64 encodedNs = startNs + result.encodeUs * 1000;
+            CaptureTrace::complete(result.reused ? "encode reused" : "encode",
+                                   startNs, encodedNs, traceId);
+            CaptureTrace::complete("write", encodedNs, encodedNs + result.writeUs * 1000, traceId);
+        }
+        
+        // Report back on the GUI thread
+        QMetaObject::invokeMethod(this, [this, id, result]() {
+            finishJob(id, result);
+        }, Qt::QueuedConnection);
+    });
+    
+    return id;
+}
+
+void SaveQueue::setSyncPolicy(CaptureFileWriter::SyncPolicy policy)
+{
+    m_syncPolicy = policy;
+}
+
+int SaveQueue::pendingCount() const
+{
+    return m_pendingCount;
+}
+
+void SaveQueue::waitForDone()
+{
+    m_pool->waitForDone();
+}
+
+void SaveQueue::finishJob(int id, const EncodeResult &result)
+{
+    --m_pendingCount;
+    
+    if (result.ok) {
+        emit saved(id, result);
+    } else {
+        emit failed(id, result);
+    }
+}
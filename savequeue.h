@@ -0,0 +1,56 @@
+#ifndef SAVEQUEUE_H
+#define SAVEQUEUE_H
+
+#include <QObject>
+#include <QImage>
+#include <QString>
+#include "imageencoder.h"
+
+class QThreadPool;
+
+// Encodes and writes captured images on a background thread pool so the
+// GUI thread never blocks on PNG compression or disk I/O.
+class SaveQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SaveQueue(QObject *parent = nullptr);
+    ~SaveQueue();
+
+    // Queue an image for saving. The queue keeps its own (implicitly
+    // shared) reference, so the caller may drop the image right away.
+    // Returns an id that is passed back through saved() or failed().
+    // The preset applies when the file suffix is its format; other
+    // suffixes use Qt's default writer for that format. A non-zero
+    // traceId records the encode and write stages in CaptureTrace. With
+    // replace off an existing file is kept and the capture takes the next
+    // free name; saved() reports the path used.
+    int enqueue(const QImage &image, const QString &filePath,
+                ImageEncoder::Preset preset = ImageEncoder::FastPng, int traceId = 0,
+                bool replace = true);
+    // Save an encode that may be shared with the clipboard; its bytes are
+    // reused if they already exist
+    int enqueue(const SharedEncodedImage &encoded, const QString &filePath, int traceId = 0,
+                bool replace = true);
+
+    // How far files are pushed to disk before saved() is reported
+    void setSyncPolicy(CaptureFileWriter::SyncPolicy policy);
+
+    int pendingCount() const;
+    void waitForDone();
+
+signals:
+    void saved(int id, const EncodeResult &result);
+    void failed(int id, const EncodeResult &result);
+
+private:
+    void finishJob(int id, const EncodeResult &result);
+
+    QThreadPool *m_pool;
+    CaptureFileWriter::SyncPolicy m_syncPolicy;
+    int m_nextId;
+    int m_pendingCount;
+};
+
+#endif // SAVEQUEUE_H
@@ -0,0 +1,293 @@
+#include "screencapture.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QPixmap>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QtMath>
+#include <cstring>
+
+namespace {
+
+struct ScreenGrab
+{
+    QImage image;
+    QRect geometry;
+    qreal devicePixelRatio;
+    qint64 grabUs;
+};
+
+// QScreen::grabWindow() goes through the platform screen, which is not
+// thread-safe on any of the desktop platforms, so this runs on the GUI
+// thread only
+void grabScreen(QScreen *screen, ScreenGrab *grab)
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    QImage image = screen->grabWindow(0).toImage();
+    if (image.format() != QImage::Format_RGB32 &&
+        image.format() != QImage::Format_ARGB32_Premultiplied) {
+        image = image.convertToFormat(QImage::Format_RGB32);
+    }
+    
+    grab->geometry = screen->geometry();
+    
+    // Calculate actual scale factor by comparing image size to screen size
+    // This handles DPI scaling correctly across all platforms
+    qreal ratio = 1.0;
+    if (!image.isNull() && grab->geometry.width() > 0 && grab->geometry.height() > 0) {
+        qreal scaleX = static_cast<qreal>(image.width()) / grab->geometry.width();
+        qreal scaleY = static_cast<qreal>(image.height()) / grab->geometry.height();
+        ratio = qMax(scaleX, scaleY);
+    }
+    
+    // If ratio is very close to 1.0, just use 1.0 to avoid floating point issues
+    if (qAbs(ratio - 1.0) < 0.01) {
+        ratio = 1.0;
+    }
+    
+    grab->image = image;
+    grab->devicePixelRatio = ratio;
+    grab->grabUs = timer.nsecsElapsed() / 1000;
+}
+
+// Raw view of the stitched frame. Workers write through the pointer
+// directly; calling QImage::scanLine() from several threads is not safe.
+struct BlitTarget
+{
+    uchar *bits;
+    qsizetype bytesPerLine;
+    QRect bounds;
+    QImage::Format format;
+};
+
+// Copy one screen into its slot of the stitched frame. Slots never
+// overlap, so several screens can be copied at the same time.
+void blitScreen(const ScreenGrab &grab, const BlitTarget &target, const QRect &targetRect)
+{
+    QImage source = grab.image;
+    if (source.size() != targetRect.size()) {
+        // Lower-DPI screen: bring it up to the frame's pixel ratio
+        source = source.scaled(targetRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    if (source.format() != target.format) {
+        source = source.convertToFormat(target.format);
+    }
+    
+    const QRect copyRect = targetRect.intersected(target.bounds);
+    if (copyRect.isEmpty() || source.isNull()) {
+        return;
+    }
+    
+    const int srcX = copyRect.x() - targetRect.x();
+    const int srcY = copyRect.y() - targetRect.y();
+    const size_t rowBytes = static_cast<size_t>(qMin(copyRect.width(), source.width() - srcX)) * 4;
+    const int rows = qMin(copyRect.height(), source.height() - srcY);
+    
+    for (int y = 0; y < rows; ++y) {
+        const uchar *src = source.constScanLine(srcY + y) + srcX * 4;
+        uchar *dst = target.bits + (copyRect.y() + y) * target.bytesPerLine + copyRect.x() * 4;
+        std::memcpy(dst, src, rowBytes);
+    }
+}
+
+} // namespace
+
+CapturedFrame ScreenCapture::grabVirtualDesktop()
+{
+    CapturedFrame frame;
+    
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    if (screens.isEmpty()) {
+        return frame;
+    }
+    
+    // Grabbed one by one here; only the compositing below uses the pool
+    const int count = screens.size();
+    QVector<ScreenGrab> grabs(count);
+    for (int i = 0; i < count; ++i) {
+        grabScreen(screens.at(i), &grabs[i]);
+    }
+    
+    // Stitch at the highest pixel ratio so no screen loses detail
+    QRect virtualGeometry;
+    qreal ratio = 1.0;
+    qint64 screenArea = 0;
+    for (int i = 0; i < count; ++i) {
+        const ScreenGrab &grab = grabs.at(i);
+        frame.screenTimings.append({screens.at(i)->name(), grab.geometry,
+                                    grab.devicePixelRatio, grab.grabUs});
+        virtualGeometry |= grab.geometry;
+        ratio = qMax(ratio, grab.devicePixelRatio);
+        screenArea += static_cast<qint64>(grab.geometry.width()) * grab.geometry.height();
+    }
+    
+    frame.geometry = virtualGeometry;
+    frame.devicePixelRatio = ratio;
+    
+    if (count == 1) {
+        // Nothing to stitch; use the grab as is
+        frame.image = grabs.at(0).image;
+        frame.devicePixelRatio = grabs.at(0).devicePixelRatio;
+        return frame;
+    }
+    
+    QElapsedTimer stitchTimer;
+    stitchTimer.start();
+    
+    QImage stitched(qCeil(virtualGeometry.width() * ratio),
+                    qCeil(virtualGeometry.height() * ratio),
+                    QImage::Format_RGB32);
+    if (stitched.isNull()) {
+        return frame;
+    }
+    
+    // Only layouts with gaps between screens need a background
+    if (screenArea < static_cast<qint64>(virtualGeometry.width()) * virtualGeometry.height()) {
+        stitched.fill(Qt::black);
+    }
+    
+    // Each screen lands in its own slot of the frame
+    QVector<QRect> targetRects(count);
+    for (int i = 0; i < count; ++i) {
+        const QRect &geometry = grabs.at(i).geometry;
+        targetRects[i] = QRect(qRound((geometry.x() - virtualGeometry.x()) * ratio),
+                               qRound((geometry.y() - virtualGeometry.y()) * ratio),
+                               qRound(geometry.width() * ratio),
+                               qRound(geometry.height() * ratio));
+    }
+    
+    const BlitTarget target = {stitched.bits(), stitched.bytesPerLine(),
+                               stitched.rect(), stitched.format()};
+    QSemaphore done;
+    for (int i = 1; i < count; ++i) {
+        const ScreenGrab *grab = &grabs.at(i);
+        const QRect targetRect = targetRects.at(i);
+        QThreadPool::globalInstance()->start([grab, &target, targetRect, &done]() {
+            blitScreen(*grab, target, targetRect);
+            done.release();
+        });
+    }
+    blitScreen(grabs.at(0), target, targetRects.at(0));
+    done.acquire(count - 1);
+    
+    frame.image = stitched;
+    frame.stitchUs = stitchTimer.nsecsElapsed() / 1000;
+    return frame;
+}
+
+QImage ScreenCapture::grabRegion(const QRect &region, int screenIndex, QString *error)
+{
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    
+    if (screenIndex >= 0) {
+        if (screenIndex >= screens.size()) {
+            if (error) {
+                *error = QString("Screen %1 does not exist (%2 screens available)")
+                         .arg(screenIndex).arg(screens.size());
+            }
+            return QImage();
+        }
+        // Region is relative to the chosen screen; an empty region means
+        // the whole screen
+        QScreen *screen = screens.at(screenIndex);
+        const QRect area = region.isEmpty() ? QRect(QPoint(0, 0), screen->geometry().size()) : region;
+        QImage image = screen->grabWindow(0, area.x(), area.y(), area.width(), area.height()).toImage();
+        if (image.isNull() && error) {
+            *error = QString("Failed to grab screen %1").arg(screenIndex);
+        }
+        image.setDevicePixelRatio(1.0);
+        return image;
+    }
+    
+    // Fast path: the region lies on a single screen
+    for (QScreen *screen : screens) {
+        const QRect geometry = screen->geometry();
+        if (!region.isEmpty() && geometry.contains(region)) {
+            const QRect local = region.translated(-geometry.topLeft());
+            QImage image = screen->grabWindow(0, local.x(), local.y(),
+                                              local.width(), local.height()).toImage();
+            if (image.isNull() && error) {
+                *error = QString("Failed to grab screen %1").arg(screen->name());
+            }
+            image.setDevicePixelRatio(1.0);
+            return image;
+        }
+    }
+    
+    // Region spans screens: grab the virtual desktop and crop it
+    CapturedFrame frame = grabVirtualDesktop();
+    if (frame.isNull()) {
+        if (error) {
+            *error = "Failed to grab the screen";
+        }
+        return QImage();
+    }
+    if (region.isEmpty()) {
+        return frame.image;
+    }
+    
+    const QRect local = region.translated(-frame.geometry.topLeft());
+    const QRect physical = toPhysical(local, frame.devicePixelRatio).intersected(frame.image.rect());
+    if (physical.isEmpty()) {
+        if (error) {
+            *error = "Region is outside the virtual desktop";
+        }
+        return QImage();
+    }
+    return frame.image.copy(physical);
+}
+
+QRect ScreenCapture::toPhysical(const QRect &logical, qreal devicePixelRatio)
+{
+    return QRect(
+        static_cast<int>(logical.x() * devicePixelRatio),
+        static_cast<int>(logical.y() * devicePixelRatio),
+        static_cast<int>(logical.width() * devicePixelRatio),
+        static_cast<int>(logical.height() * devicePixelRatio)
+    );
+}
+
+QString ScreenCapture::timingSummary(const CapturedFrame &frame)
+{
+    if (frame.screenTimings.isEmpty()) {
+        return QString();
+    }
+    
+    // Screens are grabbed one after another
+    qint64 grabUs = 0;
+    for (const ScreenGrabTiming &timing : frame.screenTimings) {
+        grabUs += timing.grabUs;
+    }
+    
+    QString summary = QString("Grab %1 ms").arg(grabUs / 1000.0, 0, 'f', 1);
+    if (frame.screenTimings.size() > 1) {
+        summary += QString(" (%1 screens) • stitch %2 ms")
+                   .arg(frame.screenTimings.size())
+                   .arg(frame.stitchUs / 1000.0, 0, 'f', 1);
+    }
+    return summary;
+}
+
+QString ScreenCapture::timingDetails(const CapturedFrame &frame)
+{
+    QStringList lines;
+    for (const ScreenGrabTiming &timing : frame.screenTimings) {
+        lines << QString("%1: %2×%3 @%4x • %5 ms")
+                 .arg(timing.screenName)
+                 .arg(timing.geometry.width())
+                 .arg(timing.geometry.height())
+                 .arg(timing.devicePixelRatio)
+                 .arg(timing.grabUs / 1000.0, 0, 'f', 1);
+    }
+    if (frame.screenTimings.size() > 1) {
+        lines << QString("Stitch %1×%2: %3 ms")
+                 .arg(frame.image.width())
+                 .arg(frame.image.height())
+                 .arg(frame.stitchUs / 1000.0, 0, 'f', 1);
+    }
+    return lines.join("\n");
+}
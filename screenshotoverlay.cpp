@@ -1,4 +1,8 @@
 #include "screenshotoverlay.h"
+#include "screencapture.h"
+#include "imageops.h"
+#include "capturetrace.h"
+#include "capturemimedata.h"
 #include <QPainter>
 #include <QMouseEvent>
 #include <QKeyEvent>
@@ -8,156 +12,402 @@
 #include <QStandardPaths>
 #include <QDateTime>
 #include <QClipboard>
-#include <QMessageBox>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QCursor>
 
-ScreenshotOverlay::ScreenshotOverlay(const QString &savePath, QWidget *parent)
+namespace {
+
+const int HandleSize = 8;
+
+QFont overlayFont(QFont font, int pointSize, bool bold)
+{
+    font.setPointSize(pointSize);
+    font.setBold(bold);
+    return font;
+}
+
+// Selection frame plus the corner handles that stick out of it
+QRect selectionOuterRect(const QRect &selection)
+{
+    if (selection.isNull()) {
+        return QRect();
+    }
+    return selection.adjusted(-HandleSize, -HandleSize, HandleSize, HandleSize);
+}
+
+// Interior of the selection that the border and handles never touch
+QRect selectionInnerRect(const QRect &selection)
+{
+    if (selection.width() <= 2 * HandleSize || selection.height() <= 2 * HandleSize) {
+        return QRect();
+    }
+    return selection.adjusted(HandleSize, HandleSize, -HandleSize, -HandleSize);
+}
+
+} // namespace
+
+ScreenshotOverlay::ScreenshotOverlay(QWidget *parent)
     : QWidget(parent)
     , m_isSelecting(false)
     , m_hasFirstPoint(false)
     , m_isDragging(false)
-    , m_savePath(savePath)
+    , m_isArmed(false)
+    , m_readyPending(false)
+    , m_mode(CaptureMode)
     , m_devicePixelRatio(1.0)
+    , m_labelFont(overlayFont(font(), 10, true))
+    , m_labelMetrics(m_labelFont)
+    , m_instructionFont(overlayFont(font(), 11, false))
+    , m_instructionMetrics(m_instructionFont)
+    , m_encoderPreset(ImageEncoder::FastPng)
+    , m_sharding(CaptureFileWriter::NoShards)
+    , m_savePathChosen(false)
+    , m_loupeEnabled(false)
+    , m_showPaintTime(false)
+    , m_lastPaintUs(0)
+    , m_lastDamagePercent(100)
 {
     setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::Tool);
     setAttribute(Qt::WA_TranslucentBackground, false);
+    // Every pixel is painted from the captured background, so skip the
+    // system background erase when the overlay is mapped
+    setAttribute(Qt::WA_OpaquePaintEvent);
     setMouseTracking(true);
     setCursor(Qt::CrossCursor);
     
-    captureScreen();
+    // Create the native window up front so the first arm() only has to map it
+    winId();
 }
 
 ScreenshotOverlay::~ScreenshotOverlay()
 {
 }
 
+void ScreenshotOverlay::arm(const QString &savePath, Mode mode)
+{
+    // Reset selection state left over from the previous capture
+    m_firstPoint = QPoint();
+    m_secondPoint = QPoint();
+    m_isSelecting = false;
+    m_hasFirstPoint = false;
+    m_isDragging = false;
+    m_damagedSelection = QRect();
+    m_damagedLabel = QRect();
+    m_savePath = savePath;
+    m_mode = mode;
+    m_isArmed = true;
+    m_readyPending = true;
+    
+    captureScreen();
+}
+
+bool ScreenshotOverlay::isArmed() const
+{
+    return m_isArmed;
+}
+
+void ScreenshotOverlay::cancel()
+{
+    disarm();
+    emit cancelled();
+}
+
+void ScreenshotOverlay::disarm()
+{
+    hide();
+    m_isArmed = false;
+    m_readyPending = false;
+    
+    // Drop the full-screen layers; they are only needed while selecting.
+    // A selection view still holding the frame keeps just that alive.
+    m_frame = QImage();
+    m_loupe.clear();
+    m_backgroundPixmap = QPixmap();
+    m_dimmedPixmap = QPixmap();
+}
+
 void ScreenshotOverlay::captureScreen()
 {
-    // Get the virtual desktop geometry (all screens combined)
-    QScreen *screen = QGuiApplication::primaryScreen();
-    if (screen) {
-        // Capture the entire screen
-        m_backgroundPixmap = screen->grabWindow(0);
-        
-        // Set geometry to cover the primary screen (logical coordinates)
-        QRect screenGeometry = screen->geometry();
-        setGeometry(screenGeometry);
-        
-        // Calculate actual scale factor by comparing pixmap size to screen size
-        // This handles DPI scaling correctly across all platforms
-        qreal scaleX = static_cast<qreal>(m_backgroundPixmap.width()) / screenGeometry.width();
-        qreal scaleY = static_cast<qreal>(m_backgroundPixmap.height()) / screenGeometry.height();
-        m_devicePixelRatio = qMax(scaleX, scaleY);
-        
-        // If ratio is very close to 1.0, just use 1.0 to avoid floating point issues
-        if (qAbs(m_devicePixelRatio - 1.0) < 0.01) {
-            m_devicePixelRatio = 1.0;
-        }
-    }
+    // Grab every screen of the virtual desktop into one frame
+    const qint64 grabStartNs = CaptureTrace::now();
+    CapturedFrame frame = ScreenCapture::grabVirtualDesktop();
+    CaptureTrace::complete("grab", grabStartNs, CaptureTrace::now());
+    const bool multiScreen = frame.screenTimings.size() > 1;
+    loadFrame(std::move(frame));
     
-    showFullScreen();
+    // Cover the whole virtual desktop (logical coordinates). Full screen
+    // mode would only cover a single monitor.
+    if (multiScreen) {
+        show();
+    } else {
+        showFullScreen();
+    }
     activateWindow();
     raise();
 }
 
+void ScreenshotOverlay::loadFrame(CapturedFrame frame)
+{
+    m_captureSummary = ScreenCapture::timingSummary(frame);
+    m_captureDetails = ScreenCapture::timingDetails(frame);
+    
+    m_devicePixelRatio = frame.devicePixelRatio;
+    m_frameOrigin = frame.geometry.topLeft();
+    
+    // Build both layers once per arm so painting a frame is only a blit.
+    // Tagging them with the pixel ratio makes drawing at logical
+    // coordinates map 1:1 onto device pixels instead of rescaling.
+    m_dimmedPixmap = QPixmap::fromImage(ImageOps::dimmed(frame.image, 100));
+    m_dimmedPixmap.setDevicePixelRatio(m_devicePixelRatio);
+    m_frame = std::move(frame.image);
+    m_backgroundPixmap = QPixmap::fromImage(m_frame);
+    m_backgroundPixmap.setDevicePixelRatio(m_devicePixelRatio);
+    
+    // The loupe reads the frame's own scanlines and shows virtual desktop
+    // coordinates in physical pixels
+    m_loupe.setImage(m_frame);
+    m_loupe.setCoordinateOffset(QPoint(qRound(m_frameOrigin.x() * m_devicePixelRatio),
+                                       qRound(m_frameOrigin.y() * m_devicePixelRatio)));
+    
+    // Keep the instructions on the primary screen (overlay coordinates)
+    m_instructionArea = QRect(QPoint(0, 0), frame.geometry.size());
+    if (QScreen *primary = QGuiApplication::primaryScreen()) {
+        m_instructionArea = primary->geometry().translated(-frame.geometry.topLeft());
+    }
+    
+    setGeometry(frame.geometry);
+}
+
+QString ScreenshotOverlay::captureSummary() const
+{
+    return m_captureSummary;
+}
+
+QString ScreenshotOverlay::captureDetails() const
+{
+    return m_captureDetails;
+}
+
+qreal ScreenshotOverlay::frameDevicePixelRatio() const
+{
+    return m_devicePixelRatio;
+}
+
+void ScreenshotOverlay::setShowPaintTime(bool show)
+{
+    m_showPaintTime = show;
+}
+
+void ScreenshotOverlay::setEncoderPreset(ImageEncoder::Preset preset)
+{
+    m_encoderPreset = preset;
+}
+
+void ScreenshotOverlay::setSharding(CaptureFileWriter::Sharding sharding)
+{
+    m_sharding = sharding;
+}
+
+bool ScreenshotOverlay::savePathChosen() const
+{
+    return m_savePathChosen;
+}
+
+QRect ScreenshotOverlay::selectionRect() const
+{
+    return QRect(m_firstPoint, m_secondPoint).normalized();
+}
+
+QRect ScreenshotOverlay::toPhysical(const QRect &logical) const
+{
+    // The background is at physical resolution, the widget is logical
+    return ScreenCapture::toPhysical(logical, m_devicePixelRatio);
+}
+
+QRectF ScreenshotOverlay::toPhysicalF(const QRect &logical) const
+{
+    return QRectF(logical.x() * m_devicePixelRatio, logical.y() * m_devicePixelRatio,
+                  logical.width() * m_devicePixelRatio, logical.height() * m_devicePixelRatio);
+}
+
+QString ScreenshotOverlay::dimensionText(const QRect &selection) const
+{
+    // Show actual physical pixel dimensions
+    int actualWidth = static_cast<int>(selection.width() * m_devicePixelRatio);
+    int actualHeight = static_cast<int>(selection.height() * m_devicePixelRatio);
+    return QString("%1 × %2").arg(actualWidth).arg(actualHeight);
+}
+
+QRect ScreenshotOverlay::dimensionLabelRect(const QRect &selection) const
+{
+    QRect textRect = m_labelMetrics.boundingRect(dimensionText(selection));
+    textRect.adjust(-8, -4, 8, 4);
+    
+    int textX = selection.center().x() - textRect.width() / 2;
+    int textY = selection.bottom() + 20;
+    
+    // Keep text on screen
+    if (textY + textRect.height() > height()) {
+        textY = selection.top() - textRect.height() - 10;
+    }
+    
+    return QRect(textX, textY, textRect.width(), textRect.height());
+}
+
+QString ScreenshotOverlay::instructionText() const
+{
+    if (m_mode == RegionMode) {
+        return "Click or drag to choose the region to capture • L for magnifier • ESC to cancel";
+    }
+    return m_hasFirstPoint ? 
+        "Click second point or drag to select • L for magnifier • ESC to cancel" : 
+        "Click first point or drag to select • L for magnifier • ESC to cancel";
+}
+
+QRect ScreenshotOverlay::instructionRect() const
+{
+    QRect textRect = m_instructionMetrics.boundingRect(instructionText());
+    textRect.adjust(-16, -8, 16, 8);
+    
+    int x = m_instructionArea.x() + (m_instructionArea.width() - textRect.width()) / 2;
+    int y = m_instructionArea.y() + 30;
+    
+    return QRect(x, y, textRect.width(), textRect.height());
+}
+
+QRect ScreenshotOverlay::paintTimeRect() const
+{
+    return QRect(m_instructionArea.left() + 20, m_instructionArea.bottom() - 44, 300, 24);
+}
+
+void ScreenshotOverlay::updateSelection()
+{
+    const bool hasSelection = m_hasFirstPoint && m_isSelecting;
+    const QRect selection = hasSelection ? selectionRect() : QRect();
+    const QRect label = hasSelection ? dimensionLabelRect(selection) : QRect();
+    
+    // Repaint the old and new selection frames and labels. Pixels well
+    // inside both the old and the new selection look the same before and
+    // after, so they are left alone.
+    QRegion damage(selectionOuterRect(m_damagedSelection));
+    damage += selectionOuterRect(selection);
+    damage -= QRegion(selectionInnerRect(m_damagedSelection))
+              .intersected(selectionInnerRect(selection));
+    damage += m_damagedLabel;
+    damage += label;
+    if (m_showPaintTime) {
+        damage += paintTimeRect();
+    }
+    
+    m_damagedSelection = selection;
+    m_damagedLabel = label;
+    
+    update(damage);
+}
+
+void ScreenshotOverlay::updateLoupe(const QPoint &pos)
+{
+    // The physical pixel under the top-left of the logical one
+    const QPoint pixel(static_cast<int>(pos.x() * m_devicePixelRatio),
+                       static_cast<int>(pos.y() * m_devicePixelRatio));
+    update(m_loupe.moveTo(pixel, pos, rect()));
+}
+
 void ScreenshotOverlay::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event);
+    QElapsedTimer paintTimer;
+    paintTimer.start();
     
     QPainter painter(this);
     
-    // Draw the captured screen (scale from physical pixels to logical pixels)
-    // The pixmap is at physical resolution, but we draw at logical resolution
-    painter.drawPixmap(rect(), m_backgroundPixmap);
-    
-    // Draw semi-transparent dark overlay
-    painter.fillRect(rect(), QColor(0, 0, 0, 100));
+    // Only the damaged area is redrawn, straight from the pre-dimmed layer
+    qint64 damagedArea = 0;
+    for (const QRect &dirty : event->region()) {
+        painter.drawPixmap(QRectF(dirty), m_dimmedPixmap, toPhysicalF(dirty));
+        damagedArea += static_cast<qint64>(dirty.width()) * dirty.height();
+    }
     
     // If we have a selection, draw it
     if (m_hasFirstPoint && m_isSelecting) {
-        QRect selectionRect = QRect(m_firstPoint, m_secondPoint).normalized();
-        
-        // Calculate the source rectangle in physical pixels
-        QRect sourceRect(
-            static_cast<int>(selectionRect.x() * m_devicePixelRatio),
-            static_cast<int>(selectionRect.y() * m_devicePixelRatio),
-            static_cast<int>(selectionRect.width() * m_devicePixelRatio),
-            static_cast<int>(selectionRect.height() * m_devicePixelRatio)
-        );
+        QRect selection = selectionRect();
         
         // Clear the selection area (show original screen)
         painter.setCompositionMode(QPainter::CompositionMode_Source);
-        painter.drawPixmap(selectionRect, m_backgroundPixmap, sourceRect);
+        painter.drawPixmap(QRectF(selection), m_backgroundPixmap, toPhysicalF(selection));
         
         // Draw selection border
         painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
         QPen pen(QColor(0, 174, 255), 2);
         painter.setPen(pen);
-        painter.drawRect(selectionRect);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(selection);
         
         // Draw corner handles
-        int handleSize = 8;
         QColor handleColor(0, 174, 255);
         painter.setBrush(handleColor);
         painter.setPen(Qt::NoPen);
         
         // Corner handles
-        painter.drawRect(selectionRect.left() - handleSize/2, selectionRect.top() - handleSize/2, handleSize, handleSize);
-        painter.drawRect(selectionRect.right() - handleSize/2, selectionRect.top() - handleSize/2, handleSize, handleSize);
-        painter.drawRect(selectionRect.left() - handleSize/2, selectionRect.bottom() - handleSize/2, handleSize, handleSize);
-        painter.drawRect(selectionRect.right() - handleSize/2, selectionRect.bottom() - handleSize/2, handleSize, handleSize);
-        
-        // Draw dimensions (show actual physical pixel dimensions)
-        int actualWidth = static_cast<int>(selectionRect.width() * m_devicePixelRatio);
-        int actualHeight = static_cast<int>(selectionRect.height() * m_devicePixelRatio);
-        QString dimensions = QString("%1 × %2").arg(actualWidth).arg(actualHeight);
-        QFont font = painter.font();
-        font.setPointSize(10);
-        font.setBold(true);
-        painter.setFont(font);
-        
-        QFontMetrics fm(font);
-        QRect textRect = fm.boundingRect(dimensions);
-        textRect.adjust(-8, -4, 8, 4);
+        painter.drawRect(selection.left() - HandleSize/2, selection.top() - HandleSize/2, HandleSize, HandleSize);
+        painter.drawRect(selection.right() - HandleSize/2, selection.top() - HandleSize/2, HandleSize, HandleSize);
+        painter.drawRect(selection.left() - HandleSize/2, selection.bottom() - HandleSize/2, HandleSize, HandleSize);
+        painter.drawRect(selection.right() - HandleSize/2, selection.bottom() - HandleSize/2, HandleSize, HandleSize);
         
-        int textX = selectionRect.center().x() - textRect.width() / 2;
-        int textY = selectionRect.bottom() + 20;
-        
-        // Keep text on screen
-        if (textY + textRect.height() > height()) {
-            textY = selectionRect.top() - textRect.height() - 10;
-        }
-        
-        painter.setPen(Qt::NoPen);
+        // Draw dimensions
+        QRect labelRect = dimensionLabelRect(selection);
         painter.setBrush(QColor(0, 0, 0, 180));
-        painter.drawRoundedRect(textX, textY, textRect.width(), textRect.height(), 4, 4);
+        painter.drawRoundedRect(labelRect, 4, 4);
         
+        painter.setFont(m_labelFont);
         painter.setPen(Qt::white);
-        painter.drawText(textX + 8, textY + fm.ascent() + 4, dimensions);
+        painter.drawText(labelRect.x() + 8, labelRect.y() + m_labelMetrics.ascent() + 4,
+                         dimensionText(selection));
     }
     
     // Draw instructions
-    QString instructions = m_hasFirstPoint ? 
-        "Click second point or drag to select • ESC to cancel" : 
-        "Click first point or drag to select • ESC to cancel";
-    
-    QFont font = painter.font();
-    font.setPointSize(11);
-    painter.setFont(font);
+    QRect instructionBox = instructionRect();
+    if (event->region().intersects(instructionBox)) {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(0, 0, 0, 200));
+        painter.drawRoundedRect(instructionBox, 6, 6);
+        
+        painter.setFont(m_instructionFont);
+        painter.setPen(Qt::white);
+        painter.drawText(instructionBox.x() + 16, instructionBox.y() + m_instructionMetrics.ascent() + 8,
+                         instructionText());
+    }
     
-    QFontMetrics fm(font);
-    QRect textRect = fm.boundingRect(instructions);
-    textRect.adjust(-16, -8, 16, 8);
+    // Magnifier on top of everything else
+    if (m_loupe.isVisible() && event->region().intersects(m_loupe.rect())) {
+        m_loupe.paint(painter);
+    }
     
-    int x = (width() - textRect.width()) / 2;
-    int y = 30;
+    // Paint time of the previous frame; this one is still being measured
+    if (m_showPaintTime) {
+        QRect hud = paintTimeRect();
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(0, 0, 0, 200));
+        painter.drawRoundedRect(hud, 4, 4);
+        
+        const qint64 paintUs = qMax<qint64>(1, m_lastPaintUs);
+        painter.setFont(m_labelFont);
+        painter.setPen(Qt::white);
+        painter.drawText(hud, Qt::AlignCenter,
+                         QString("Paint %1 ms • %2 fps • %3% repainted")
+                         .arg(paintUs / 1000.0, 0, 'f', 2)
+                         .arg(1000000 / paintUs)
+                         .arg(m_lastDamagePercent));
+    }
     
-    painter.setPen(Qt::NoPen);
-    painter.setBrush(QColor(0, 0, 0, 200));
-    painter.drawRoundedRect(x, y, textRect.width(), textRect.height(), 6, 6);
+    const qint64 fullArea = qMax<qint64>(1, static_cast<qint64>(width()) * height());
+    m_lastDamagePercent = static_cast<int>(qMin<qint64>(100, damagedArea * 100 / fullArea));
+    m_lastPaintUs = paintTimer.nsecsElapsed() / 1000;
     
-    painter.setPen(Qt::white);
-    painter.drawText(x + 16, y + fm.ascent() + 8, instructions);
+    if (m_readyPending) {
+        m_readyPending = false;
+        emit ready();
+    }
 }
 
 void ScreenshotOverlay::mousePressEvent(QMouseEvent *event)
@@ -170,7 +420,10 @@ void ScreenshotOverlay::mousePressEvent(QMouseEvent *event)
             m_hasFirstPoint = true;
             m_isSelecting = true;
             m_isDragging = true;
-            update();
+            
+            // The instruction text changes after the first point
+            update(instructionRect());
+            updateSelection();
         } else if (!m_isDragging) {
             // Second click - set second point and capture
             m_secondPoint = event->pos();
@@ -178,8 +431,7 @@ void ScreenshotOverlay::mousePressEvent(QMouseEvent *event)
         }
     } else if (event->button() == Qt::RightButton) {
         // Cancel
-        emit cancelled();
-        close();
+        cancel();
     }
 }
 
@@ -187,7 +439,10 @@ void ScreenshotOverlay::mouseMoveEvent(QMouseEvent *event)
 {
     if (m_isDragging && m_hasFirstPoint) {
         m_secondPoint = event->pos();
-        update();
+        updateSelection();
+    }
+    if (m_loupeEnabled) {
+        updateLoupe(event->pos());
     }
 }
 
@@ -198,12 +453,12 @@ void ScreenshotOverlay::mouseReleaseEvent(QMouseEvent *event)
         m_isDragging = false;
         
         // If dragged a meaningful distance, take screenshot immediately
-        QRect selection = QRect(m_firstPoint, m_secondPoint).normalized();
+        QRect selection = selectionRect();
         if (selection.width() > 5 && selection.height() > 5) {
             takeScreenshot();
         } else {
             // Small click, wait for second click
-            update();
+            updateSelection();
         }
     }
 }
@@ -211,83 +466,91 @@ void ScreenshotOverlay::mouseReleaseEvent(QMouseEvent *event)
 void ScreenshotOverlay::keyPressEvent(QKeyEvent *event)
 {
     if (event->key() == Qt::Key_Escape) {
-        emit cancelled();
-        close();
+        cancel();
     } else if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) {
         if (m_hasFirstPoint && m_isSelecting) {
             takeScreenshot();
         }
+    } else if (event->key() == Qt::Key_L) {
+        m_loupeEnabled = !m_loupeEnabled;
+        if (m_loupeEnabled) {
+            updateLoupe(mapFromGlobal(QCursor::pos()));
+        } else {
+            update(m_loupe.hide());
+        }
     }
 }
 
 void ScreenshotOverlay::takeScreenshot()
 {
-    QRect selection = QRect(m_firstPoint, m_secondPoint).normalized();
+    QRect selection = selectionRect();
     
     if (selection.width() < 1 || selection.height() < 1) {
-        emit cancelled();
-        close();
+        cancel();
+        return;
+    }
+    CaptureTrace::instant("selection finished");
+    
+    if (m_mode == RegionMode) {
+        disarm();
+        emit regionSelected(selection.translated(m_frameOrigin));
         return;
     }
     
     // Scale selection to physical pixels (the pixmap is at physical resolution)
-    QRect physicalSelection(
-        static_cast<int>(selection.x() * m_devicePixelRatio),
-        static_cast<int>(selection.y() * m_devicePixelRatio),
-        static_cast<int>(selection.width() * m_devicePixelRatio),
-        static_cast<int>(selection.height() * m_devicePixelRatio)
-    );
+    QRect physicalSelection = toPhysical(selection);
     
-    // Extract the selected region from the captured screen
-    QPixmap screenshot = m_backgroundPixmap.copy(physicalSelection);
+    // The clipboard, the save and the history all share these pixels and
+    // can hold them indefinitely, so a partial selection gets its own
+    // buffer rather than a view that keeps the whole frame alive
+    const QRect bounded = physicalSelection.intersected(m_frame.rect());
+    const QImage screenshot = bounded == m_frame.rect() ? m_frame : m_frame.copy(bounded);
+    
+    // One PNG encode shared by the clipboard and the file save; nothing
+    // is converted or compressed until one of them asks for the bytes.
+    // The smallest-PNG preset is kept for both, anything else uses the
+    // fast one for the clipboard.
+    const ImageEncoder::Preset pngPreset = m_encoderPreset == ImageEncoder::MaxPng
+                                           ? ImageEncoder::MaxPng : ImageEncoder::FastPng;
+    SharedEncodedImage encoded(new EncodedImage(screenshot, "png", pngPreset));
     
     // Copy to clipboard
-    QGuiApplication::clipboard()->setPixmap(screenshot);
+    {
+        CaptureTrace::Span span("clipboard");
+        QGuiApplication::clipboard()->setMimeData(new CaptureMimeData(encoded));
+    }
     
-    // Generate filename with timestamp
-    QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss");
+    // Generated names have milliseconds and a sequence, so captures in
+    // quick succession never share one
+    const QDateTime now = QDateTime::currentDateTime();
     QString filename;
-    QString savedPath;
+    m_savePathChosen = false;
     
-    // Hide overlay before any dialogs
-    hide();
+    // Hide overlay before any dialogs and release the background grab
+    disarm();
     
+    // Only the target path is decided here; encoding and writing happen on
+    // MainWindow's background save queue so the GUI never waits on them
+    const QString suffix = "." + QString::fromLatin1(ImageEncoder::fileSuffix(m_encoderPreset));
     if (!m_savePath.isEmpty() && QDir(m_savePath).exists()) {
         // Auto-save to configured folder
-        filename = m_savePath + "/screenshot_" + timestamp + ".png";
-        
-        if (screenshot.save(filename)) {
-            savedPath = filename;
-            emit screenshotTaken(screenshot, savedPath);
-        } else {
-            QMessageBox::warning(nullptr, "Error", "Failed to save screenshot to:\n" + filename);
-            emit screenshotTaken(screenshot, QString());
-        }
+        filename = CaptureFileWriter::uniquePath(m_savePath, "screenshot", suffix, m_sharding, now);
     } else {
         // No save path configured, ask user
         QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation);
-        QString defaultFilename = defaultPath + "/screenshot_" + timestamp + ".png";
+        QString defaultFilename = CaptureFileWriter::uniquePath(defaultPath, "screenshot", suffix,
+                                                                CaptureFileWriter::NoShards, now);
         
+        // An empty result means the user cancelled, but the screenshot is
+        // still in the clipboard
         filename = QFileDialog::getSaveFileName(
             nullptr,
             "Save Screenshot",
             defaultFilename,
-            "PNG Image (*.png);;JPEG Image (*.jpg *.jpeg);;All Files (*.*)"
+            ImageEncoder::fileDialogFilter(m_encoderPreset)
         );
-        
-        if (!filename.isEmpty()) {
-            if (screenshot.save(filename)) {
-                savedPath = filename;
-                emit screenshotTaken(screenshot, savedPath);
-            } else {
-                QMessageBox::warning(nullptr, "Error", "Failed to save screenshot.");
-                emit screenshotTaken(screenshot, QString());
-            }
-        } else {
-            // User cancelled save, but screenshot is still in clipboard
-            emit screenshotTaken(screenshot, QString());
-        }
+        m_savePathChosen = !filename.isEmpty();
     }
     
-    close();
+    emit screenshotTaken(screenshot, filename, encoded);
 }
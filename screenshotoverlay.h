@@ -4,18 +4,70 @@
 #include <QWidget>
 #include <QPoint>
 #include <QPixmap>
+#include <QImage>
+#include <QRect>
+#include <QRegion>
+#include <QFont>
+#include <QFontMetrics>
+#include "imageencoder.h"
+#include "screencapture.h"
+#include "pixelloupe.h"
 
 class ScreenshotOverlay : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit ScreenshotOverlay(const QString &savePath = QString(), QWidget *parent = nullptr);
+    enum Mode {
+        CaptureMode,    // Crop the selection and emit screenshotTaken()
+        RegionMode      // Only report the selected area via regionSelected()
+    };
+
+    explicit ScreenshotOverlay(QWidget *parent = nullptr);
     ~ScreenshotOverlay();
 
+    // Grab the screen and show the overlay for a new selection.
+    // The widget is kept alive between captures and re-armed each time.
+    void arm(const QString &savePath, Mode mode = CaptureMode);
+    bool isArmed() const;
+
+    // Build the overlay layers from an already captured frame and size
+    // the widget to it, without showing it. arm() calls this after each
+    // grab; cordshot_bench feeds it synthetic frames.
+    void loadFrame(CapturedFrame frame);
+
+    // Capture cost of the last arm(): a one-line summary and a per-screen
+    // breakdown
+    QString captureSummary() const;
+    QString captureDetails() const;
+    // Physical pixels per logical pixel of the last frame
+    qreal frameDevicePixelRatio() const;
+
+    // Draw the measured paint time of each frame in a corner of the overlay
+    void setShowPaintTime(bool show);
+
+    // Decides the suffix of generated file names and the default filter
+    // of the save dialog
+    void setEncoderPreset(ImageEncoder::Preset preset);
+    // Subfolders generated file names go into
+    void setSharding(CaptureFileWriter::Sharding sharding);
+    // True when the last save path was picked in the save dialog, which
+    // already asked before replacing a file. Generated names never should.
+    bool savePathChosen() const;
+
 signals:
-    void screenshotTaken(const QPixmap &screenshot, const QString &savedPath);
+    // savePath is where the screenshot should be written, or empty when
+    // it only goes to the clipboard. encoded is the PNG encode the
+    // clipboard serves from; saving a PNG should reuse it.
+    // screenshot owns just the selected pixels; a selection of the whole
+    // frame shares the frame's buffer.
+    void screenshotTaken(const QImage &screenshot, const QString &savePath,
+                         const SharedEncodedImage &encoded);
+    // region is in logical virtual-desktop coordinates
+    void regionSelected(const QRect &region);
     void cancelled();
+    // Emitted once per arm, after the first frame has been painted
+    void ready();
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -27,15 +79,63 @@ protected:
 private:
     void captureScreen();
     void takeScreenshot();
+    void cancel();
+    void disarm();
 
+    QRect selectionRect() const;
+    QRect toPhysical(const QRect &logical) const;
+    QRectF toPhysicalF(const QRect &logical) const;
+    QString dimensionText(const QRect &selection) const;
+    QRect dimensionLabelRect(const QRect &selection) const;
+    QString instructionText() const;
+    QRect instructionRect() const;
+    QRect paintTimeRect() const;
+    void updateSelection();
+    void updateLoupe(const QPoint &pos);
+
+    // The grabbed frame, which selections are cut from as views
+    QImage m_frame;
+    // Un-dimmed capture and its pre-dimmed copy, both at physical
+    // resolution with the device pixel ratio set
     QPixmap m_backgroundPixmap;
+    QPixmap m_dimmedPixmap;
     QPoint m_firstPoint;
     QPoint m_secondPoint;
     bool m_isSelecting;
     bool m_hasFirstPoint;
     bool m_isDragging;
+    bool m_isArmed;
+    bool m_readyPending;
     QString m_savePath;
+    Mode m_mode;
+    QPoint m_frameOrigin;
     qreal m_devicePixelRatio;
+    QRect m_instructionArea;
+    QString m_captureSummary;
+    QString m_captureDetails;
+
+    // Fonts and metrics are built once rather than on every paint
+    QFont m_labelFont;
+    QFontMetrics m_labelMetrics;
+    QFont m_instructionFont;
+    QFontMetrics m_instructionMetrics;
+
+    // What was last scheduled for repaint, so the next update can cover
+    // both the old and the new selection frame
+    QRect m_damagedSelection;
+    QRect m_damagedLabel;
+
+    ImageEncoder::Preset m_encoderPreset;
+    CaptureFileWriter::Sharding m_sharding;
+    bool m_savePathChosen;
+
+    // Magnifier toggled with L; stays on across captures
+    PixelLoupe m_loupe;
+    bool m_loupeEnabled;
+
+    bool m_showPaintTime;
+    qint64 m_lastPaintUs;
+    int m_lastDamagePercent;
 };
 
 #endif // SCREENSHOTOVERLAY_H
@@ -0,0 +1,68 @@
+#include "startupprofile.h"
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVector>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct Milestone
+{
+    const char *name;          // String literal; never copied
+    qint64 ns;
+};
+
+const QElapsedTimer *startTimer = nullptr;
+QVector<Milestone> milestones;
+bool reporting = false;
+bool reported = false;
+
+} // namespace
+
+void StartupProfile::start(const QElapsedTimer &timer)
+{
+    startTimer = &timer;
+}
+
+void StartupProfile::setReporting(bool enabled)
+{
+    reporting = enabled;
+}
+
+void StartupProfile::mark(const char *name)
+{
+    if (!startTimer || hasMark(name)) {
+        return;
+    }
+    milestones.append({name, startTimer->nsecsElapsed()});
+}
+
+bool StartupProfile::hasMark(const char *name)
+{
+    for (const Milestone &milestone : milestones) {
+        if (std::strcmp(milestone.name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString StartupProfile::summary()
+{
+    QStringList parts;
+    for (const Milestone &milestone : milestones) {
+        parts.append(QString("%1 %2 ms").arg(QString::fromLatin1(milestone.name))
+                     .arg(milestone.ns / 1e6, 0, 'f', 1));
+    }
+    return parts.join(" • ");
+}
+
+void StartupProfile::report()
+{
+    if (!reporting || reported) {
+        return;
+    }
+    reported = true;
+    QTextStream(stderr) << "cordshot: startup • " << summary() << "\n";
+}
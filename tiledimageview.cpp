@@ -0,0 +1,438 @@
+#include "tiledimageview.h"
+#include "imageops.h"
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QThread>
+#include <QWheelEvent>
+#include <cmath>
+
+namespace {
+
+// Tile edge in pixels of its own level
+const int TileSize = 256;
+
+// Longest edge of the stand-in preview
+const int PreviewSize = 1024;
+
+// Cache budget in KB (the cost unit of m_tiles)
+const int TileCacheKb = 128 * 1024;
+
+const qreal MaxZoom = 32.0;
+
+// Keyboard zoom step, half a doubling
+const qreal ZoomStep = 1.4142135623730951;
+
+const QColor BackgroundColor(0x1A, 0x1A, 0x2A);
+
+inline quint64 tileKey(int level, int column, int row)
+{
+    return (quint64(level) << 56) | (quint64(row) << 28) | quint64(column);
+}
+
+inline int tileCost(const QPixmap &tile)
+{
+    return qMax(1, tile.width() * tile.height() * 4 / 1024);
+}
+
+} // namespace
+
+TiledImageView::TiledImageView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+    , m_tiles(TileCacheKb)
+    , m_generation(0)
+    , m_maxLevel(0)
+    , m_lastLevel(-1)
+    , m_zoom(1.0)
+    , m_fitted(true)
+    , m_panning(false)
+{
+    // Its own pool: tile jobs split their downsample into stripes on the
+    // global pool and wait for them, which must not starve
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+    
+    horizontalScrollBar()->setSingleStep(24);
+    verticalScrollBar()->setSingleStep(24);
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+TiledImageView::~TiledImageView()
+{
+    // Running jobs post back to this object
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void TiledImageView::setImage(const QImage &image)
+{
+    ++m_generation;
+    m_pool.clear();
+    m_pending.clear();
+    m_tiles.clear();
+    
+    m_image = image;
+    m_lastLevel = -1;
+    m_maxLevel = 0;
+    while ((qMax(image.width(), image.height()) >> m_maxLevel) > TileSize) {
+        ++m_maxLevel;
+    }
+    
+    // Nearest-neighbour sampling reads one source pixel per preview pixel,
+    // so this costs the same for a 16K capture as for a 1080p one. An
+    // image that already fits is its own preview, never enlarged.
+    if (image.width() <= PreviewSize && image.height() <= PreviewSize) {
+        m_preview = image;
+    } else {
+        m_preview = image.scaled(PreviewSize, PreviewSize, Qt::KeepAspectRatio,
+                                 Qt::FastTransformation);
+    }
+    
+    zoomToFit();
+}
+
+QImage TiledImageView::image() const
+{
+    return m_image;
+}
+
+qreal TiledImageView::zoom() const
+{
+    return m_zoom;
+}
+
+void TiledImageView::setZoom(qreal zoom, const QPointF &anchor)
+{
+    m_fitted = false;
+    applyZoom(zoom, anchor);
+}
+
+void TiledImageView::zoomToFit()
+{
+    m_fitted = true;
+    applyZoom(fitZoom(), QPointF(-1, -1));
+}
+
+QPointF TiledImageView::mapToImage(const QPointF &viewportPos) const
+{
+    return (viewportPos - imageOrigin()) / m_zoom;
+}
+
+QPointF TiledImageView::mapFromImage(const QPointF &imagePos) const
+{
+    return imagePos * m_zoom + imageOrigin();
+}
+
+bool TiledImageView::pixelAt(const QPoint &viewportPos, QPoint *pixel) const
+{
+    // Sample at the centre of the viewport pixel
+    const QPointF pos = mapToImage(QPointF(viewportPos) + QPointF(0.5, 0.5));
+    const QPoint found(int(std::floor(pos.x())), int(std::floor(pos.y())));
+    if (m_image.isNull() || !m_image.rect().contains(found)) {
+        return false;
+    }
+    *pixel = found;
+    return true;
+}
+
+void TiledImageView::paintOverlay(QPainter &painter, const QRegion &exposed)
+{
+    Q_UNUSED(painter);
+    Q_UNUSED(exposed);
+}
+
+void TiledImageView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    
+    // Small updates (a crosshair strip, one marker) arrive as a region of
+    // a few thin rects; its bounding rect could be the whole viewport
+    const QRegion exposed = event->region();
+    for (const QRect &rect : exposed) {
+        painter.setClipRect(rect);
+        paintTiles(painter, rect);
+    }
+    
+    painter.setClipRegion(exposed);
+    paintOverlay(painter, exposed);
+}
+
+void TiledImageView::paintTiles(QPainter &painter, const QRect &exposed)
+{
+    painter.fillRect(exposed, BackgroundColor);
+    if (m_image.isNull()) {
+        return;
+    }
+    
+    const int level = levelForZoom(m_zoom);
+    if (level != m_lastLevel) {
+        // Tiles still queued for the previous level are no longer wanted
+        m_pool.clear();
+        m_pending.clear();
+        m_lastLevel = level;
+    }
+    
+    const QRectF visible = QRectF(mapToImage(exposed.topLeft()),
+                                  mapToImage(exposed.bottomRight() + QPoint(1, 1)))
+                           .intersected(QRectF(m_image.rect()));
+    if (visible.isEmpty()) {
+        return;
+    }
+    
+    const int span = TileSize << level;
+    const int firstColumn = int(visible.left()) / span;
+    const int lastColumn = (int(std::ceil(visible.right())) - 1) / span;
+    const int firstRow = int(visible.top()) / span;
+    const int lastRow = (int(std::ceil(visible.bottom())) - 1) / span;
+    const qreal previewScale = qreal(m_preview.width()) / m_image.width();
+    
+    // Smooth when shrinking; above 100% every source pixel is a crisp block
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, m_zoom < 1.0);
+    
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            const QRect source = tileRect(level, column, row);
+            const QRect target = tileTarget(source);
+            const quint64 key = tileKey(level, column, row);
+            
+            QPixmap *tile = m_tiles.object(key);
+            if (!tile && level == 0) {
+                // Full-resolution tiles are a plain pixel copy, cheap
+                // enough to make here
+                tile = new QPixmap(QPixmap::fromImage(ImageOps::regionView(m_image, source)));
+                m_tiles.insert(key, tile, tileCost(*tile));
+            }
+            
+            if (tile) {
+                painter.drawPixmap(target, *tile);
+            } else {
+                requestTile(level, column, row, key);
+                painter.drawImage(QRectF(target), m_preview,
+                                  QRectF(source.x() * previewScale, source.y() * previewScale,
+                                         source.width() * previewScale,
+                                         source.height() * previewScale));
+            }
+        }
+    }
+}
+
+void TiledImageView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    if (m_fitted) {
+        applyZoom(fitZoom(), QPointF(-1, -1));
+    } else {
+        updateScrollBars();
+    }
+}
+
+void TiledImageView::wheelEvent(QWheelEvent *event)
+{
+    const int delta = event->angleDelta().y();
+    if (delta == 0 || m_image.isNull()) {
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+    
+    // A notch is a quarter of a doubling; touchpads send finer steps,
+    // which gives them continuous zoom
+    setZoom(m_zoom * std::pow(2.0, delta / 480.0), event->position());
+    event->accept();
+}
+
+void TiledImageView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::MiddleButton) {
+        m_panning = true;
+        m_panStart = event->pos();
+        QGuiApplication::setOverrideCursor(Qt::ClosedHandCursor);
+        event->accept();
+        return;
+    }
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+void TiledImageView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (m_panning) {
+        const QPoint delta = event->pos() - m_panStart;
+        m_panStart = event->pos();
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() - delta.x());
+        verticalScrollBar()->setValue(verticalScrollBar()->value() - delta.y());
+        event->accept();
+        return;
+    }
+    QAbstractScrollArea::mouseMoveEvent(event);
+}
+
+void TiledImageView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (m_panning && event->button() == Qt::MiddleButton) {
+        m_panning = false;
+        QGuiApplication::restoreOverrideCursor();
+        event->accept();
+        return;
+    }
+    QAbstractScrollArea::mouseReleaseEvent(event);
+}
+
+void TiledImageView::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_0:
+        zoomToFit();
+        break;
+    case Qt::Key_1:
+        setZoom(1.0);
+        break;
+    case Qt::Key_Plus:
+    case Qt::Key_Equal:
+        setZoom(m_zoom * ZoomStep);
+        break;
+    case Qt::Key_Minus:
+        setZoom(m_zoom / ZoomStep);
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+int TiledImageView::levelForZoom(qreal zoom) const
+{
+    // The coarsest level still drawn at half its size or more
+    int level = 0;
+    while (level < m_maxLevel && zoom * (2 << level) <= 1.0) {
+        ++level;
+    }
+    return level;
+}
+
+QRect TiledImageView::tileRect(int level, int column, int row) const
+{
+    const int span = TileSize << level;
+    return QRect(column * span, row * span, span, span).intersected(m_image.rect());
+}
+
+QRect TiledImageView::tileTarget(const QRect &source) const
+{
+    // Both edges rounded the same way, so neighbouring tiles meet exactly
+    const QPointF origin = imageOrigin();
+    const QPoint topLeft(qRound(origin.x() + source.left() * m_zoom),
+                         qRound(origin.y() + source.top() * m_zoom));
+    const QPoint bottomRight(qRound(origin.x() + (source.right() + 1) * m_zoom),
+                             qRound(origin.y() + (source.bottom() + 1) * m_zoom));
+    return QRect(topLeft, bottomRight - QPoint(1, 1));
+}
+
+void TiledImageView::requestTile(int level, int column, int row, quint64 key)
+{
+    if (m_pending.contains(key)) {
+        return;
+    }
+    m_pending.insert(key);
+    
+    const QImage image = m_image;
+    const QRect source = tileRect(level, column, row);
+    const int generation = m_generation;
+    m_pool.start([this, image, source, level, generation, key]() {
+        QImage region = ImageOps::regionView(image, source);
+        // The kernels read QRgb; RGBA8888 and RGB30 are 32-bit but not that
+        const QImage::Format format = region.format();
+        if (format != QImage::Format_RGB32 && format != QImage::Format_ARGB32
+            && format != QImage::Format_ARGB32_Premultiplied) {
+            region = region.convertToFormat(region.hasAlphaChannel()
+                                            ? QImage::Format_ARGB32_Premultiplied
+                                            : QImage::Format_RGB32);
+        }
+        const QImage tile = ImageOps::boxDownsample(region, 1 << level);
+        
+        QMetaObject::invokeMethod(this, [this, generation, key, tile]() {
+            onTileReady(generation, key, tile);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TiledImageView::onTileReady(int generation, quint64 key, const QImage &tile)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    m_pending.remove(key);
+    
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(tile));
+    m_tiles.insert(key, pixmap, tileCost(*pixmap));
+    
+    const int level = int(key >> 56);
+    if (level == m_lastLevel) {
+        const int row = int((key >> 28) & 0xFFFFFFF);
+        const int column = int(key & 0xFFFFFFF);
+        viewport()->update(tileTarget(tileRect(level, column, row)));
+    }
+}
+
+void TiledImageView::applyZoom(qreal zoom, const QPointF &anchor)
+{
+    if (m_image.isNull()) {
+        m_zoom = 1.0;
+        updateScrollBars();
+        viewport()->update();
+        return;
+    }
+    
+    zoom = qBound(qMin(fitZoom(), 1.0), zoom, MaxZoom);
+    const QPointF at = anchor.x() < 0 ? QPointF(viewport()->width() / 2.0,
+                                                viewport()->height() / 2.0)
+                                      : anchor;
+    const QPointF imagePos = mapToImage(at);
+    
+    m_zoom = zoom;
+    updateScrollBars();
+    horizontalScrollBar()->setValue(qRound(imagePos.x() * m_zoom - at.x()));
+    verticalScrollBar()->setValue(qRound(imagePos.y() * m_zoom - at.y()));
+    
+    viewport()->update();
+    emit zoomChanged(m_zoom);
+}
+
+qreal TiledImageView::fitZoom() const
+{
+    if (m_image.isNull()) {
+        return 1.0;
+    }
+    const qreal fit = qMin(qreal(viewport()->width()) / m_image.width(),
+                           qreal(viewport()->height()) / m_image.height());
+    // Small captures grow by whole steps so their pixels stay square
+    return fit >= 1.0 ? qMin(std::floor(fit), MaxZoom) : fit;
+}
+
+QPointF TiledImageView::imageOrigin() const
+{
+    // Centred while smaller than the viewport, scrolled otherwise
+    const QSize content = contentSize();
+    const qreal x = content.width() < viewport()->width()
+                    ? (viewport()->width() - content.width()) / 2
+                    : -horizontalScrollBar()->value();
+    const qreal y = content.height() < viewport()->height()
+                    ? (viewport()->height() - content.height()) / 2
+                    : -verticalScrollBar()->value();
+    return QPointF(x, y);
+}
+
+QSize TiledImageView::contentSize() const
+{
+    return QSize(int(std::ceil(m_image.width() * m_zoom)),
+                 int(std::ceil(m_image.height() * m_zoom)));
+}
+
+void TiledImageView::updateScrollBars()
+{
+    const QSize content = contentSize();
+    const QSize view = viewport()->size();
+    horizontalScrollBar()->setRange(0, qMax(0, content.width() - view.width()));
+    horizontalScrollBar()->setPageStep(view.width());
+    verticalScrollBar()->setRange(0, qMax(0, content.height() - view.height()));
+    verticalScrollBar()->setPageStep(view.height());
+}
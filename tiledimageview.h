@@ -0,0 +1,87 @@
+#ifndef TILEDIMAGEVIEW_H
+#define TILEDIMAGEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QCache>
+#include <QImage>
+#include <QPixmap>
+#include <QRegion>
+#include <QSet>
+#include <QThreadPool>
+
+// Zoomable, pannable view of an image of any size. Nothing is rescaled
+// up front: the image is cut into tiles per mip level (each level half
+// the size of the one below), and only tiles that come into view are
+// built, on a background pool, then cached as pixmaps. Until a tile
+// arrives, a small point-sampled preview stands in for it.
+//
+// The wheel zooms around the cursor, the middle button drags, 0 fits
+// the image and 1 shows it at 100%.
+class TiledImageView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit TiledImageView(QWidget *parent = nullptr);
+    ~TiledImageView() override;
+
+    // Shows image fitted to the view. The image is shared, not copied,
+    // so a view into a larger frame works as-is.
+    virtual void setImage(const QImage &image);
+    QImage image() const;
+
+    qreal zoom() const;
+    // anchor is the viewport point that stays put; the centre if omitted
+    void setZoom(qreal zoom, const QPointF &anchor = QPointF(-1, -1));
+    void zoomToFit();
+
+    // Between viewport positions and image coordinates in source pixels
+    QPointF mapToImage(const QPointF &viewportPos) const;
+    QPointF mapFromImage(const QPointF &imagePos) const;
+    // Source pixel under a viewport position; false outside the image
+    bool pixelAt(const QPoint &viewportPos, QPoint *pixel) const;
+
+signals:
+    void zoomChanged(qreal zoom);
+
+protected:
+    // Draws on top of the tiles; painter is on the viewport and clipped
+    // to the exposed region
+    virtual void paintOverlay(QPainter &painter, const QRegion &exposed);
+
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    void paintTiles(QPainter &painter, const QRect &exposed);
+    int levelForZoom(qreal zoom) const;
+    QRect tileRect(int level, int column, int row) const;
+    QRect tileTarget(const QRect &source) const;
+    void requestTile(int level, int column, int row, quint64 key);
+    void onTileReady(int generation, quint64 key, const QImage &tile);
+    void applyZoom(qreal zoom, const QPointF &anchor);
+    qreal fitZoom() const;
+    QPointF imageOrigin() const;
+    QSize contentSize() const;
+    void updateScrollBars();
+
+    QImage m_image;
+    QImage m_preview;              // Point-sampled; drawn under missing tiles
+    QCache<quint64, QPixmap> m_tiles;
+    QSet<quint64> m_pending;
+    QThreadPool m_pool;
+    int m_generation;              // Bumped per image; stale tiles are dropped
+    int m_maxLevel;
+    int m_lastLevel;
+    qreal m_zoom;
+    bool m_fitted;
+    bool m_panning;
+    QPoint m_panStart;
+};
+
+#endif // TILEDIMAGEVIEW_H